@@ -28,7 +28,9 @@ class App {
         enum class Mode {
             PLAY,
             BOT_VS_BOT,
-            BENCHMARK
+            BENCHMARK,
+            SOLVE,
+            CALIBRATE
         };
 
     private:
@@ -50,6 +52,9 @@ class App {
         /// @brief Runs 'BENCHMARK' mode.
         void run_benchmark();
 
+        /// @brief Runs 'SOLVE' mode.
+        void run_solve();
+
     public:
         /**
          * @brief Default Terminal constructor.
@@ -25,7 +25,7 @@ struct DefaultSettings {
     static constexpr App::Mode MODE = App::Mode::PLAY;
     static constexpr UI::UIStyle STYLE = UI::UIStyle::BASIC;
     static constexpr Engine::Alg ALG = Engine::Alg::NEGASCOUT;
-    static constexpr Engine::Settings SETTINGS = {10, 0, 1, true, Move_order::Orders::OPTIMIZED};
+    static constexpr Engine::Settings SETTINGS = {10, 0, 1, true, 64, true, true, true, false, 0, 3, 2.0, 2, nullptr, 16, 2, 20, false, true, Move_order::Orders::OPTIMIZED};
 };
 
 #endif
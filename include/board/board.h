@@ -57,6 +57,26 @@ class Board {
          */
         uint64_t black_bitmap;
 
+        /**
+         * @brief Zobrist key of the pieces on the board.
+         * 
+         * Maintained incrementally by play_move, so hashing is nearly free.
+         */
+        uint64_t hash_key;
+
+        /// @brief Computes zobrist key of the bitmaps from scratch.
+        static uint64_t compute_hash(uint64_t white_bitmap, uint64_t black_bitmap);
+
+        /**
+         * @brief Updates zobrist key after a move.
+         * 
+         * @tparam COLOR Color of the player who played the move.
+         * @param move Bitmap of the placed piece.
+         * @param flipped Bitmap of all pieces flipped by the move.
+         */
+        template <bool COLOR>
+        void update_hash(uint64_t move, uint64_t flipped);
+
     public:   
         /**
          * @brief Heuristic values for board evaluation.
@@ -79,6 +99,7 @@ class Board {
             static const Board INITIAL;
             static const Board TEST;
             static const Board BENCHMARK;
+            static const Board ENDGAME;
         };
 
         /**
@@ -101,6 +122,31 @@ class Board {
          */
         void play_move(bool color, uint64_t move);
 
+        /**
+         * @brief Plays a move of the player given at compile time.
+         * 
+         * @tparam COLOR The color of the player (true for white, false for black).
+         * @param move Bitmap representing the move to be played.
+         * 
+         * Used by search kernels specialized for each color, the bitmaps
+         * of the player and the opponent are picked without a branch.
+         */
+        template <bool COLOR>
+        void play_move(uint64_t move);
+
+        /**
+         * @brief Finds pieces flipped by a move, the same kernel play_move uses.
+         * 
+         * @param playing Pieces of the player making the move.
+         * @param opponent Pieces of the opponent.
+         * @param move Bitmap representing the move.
+         * @return uint64_t Bitmap of flipped pieces, 0 if the move is not legal.
+         * 
+         * Used by the endgame solver, which keeps the pieces of the player
+         * at turn and the opponent instead of the board.
+         */
+        static uint64_t flips(uint64_t playing, uint64_t opponent, uint64_t move);
+
         /**
          * @brief Finds all possible moves for the given color.
          * 
@@ -109,6 +155,15 @@ class Board {
          */
         uint64_t find_moves(bool color) const;
 
+        /**
+         * @brief Finds all possible moves for the color given at compile time.
+         * 
+         * @tparam COLOR The color of the player (true for white, false for black).
+         * @return uint64_t Bitmap representing all possible moves for the given color.
+         */
+        template <bool COLOR>
+        uint64_t find_moves() const;
+
         /// @brief White bitmap getter. 
         uint64_t white() const;
 
@@ -133,10 +188,16 @@ class Board {
         /**
          * @brief Generates a hash value for the current board state.
          * 
+         * @param color Player at turn (true for white, false for black).
          * @return uint64_t The hash value representing the current board state.
          * 
-         * Uses murmur3 hashing algorithm.
+         * Uses zobrist hashing, player at turn is part of the hash,
+         * so same pieces with different player at turn do not collide.
          */
+        uint64_t hash(bool color) const;
+
+        /// @brief Hash value with the player at turn given at compile time, see hash.
+        template <bool COLOR>
         uint64_t hash() const;
 };
 
@@ -20,7 +20,9 @@
 
 #include "engine/engine.h"
 #include "engine/move_order.h"
+#include "engine/move_history.h"
 #include "engine/transposition_table.h"
+#include "engine/pv_table.h"
 
 /**
  * @brief Class implementing negascout game-tree search.
@@ -42,27 +44,56 @@ class Alphabeta : public Engine {
         /// @brief Array storing the order in which possible moves are evaluated to optimize search performance.
         Move_order move_order;
 
+        /// @brief Killer moves and history scores, searched before the static order.
+        Move_history move_history;
+
         /// @brief The transposition table used to store previously evaluated game states and their results, improving search efficiency.
         TranspositionTable transposition_table;
 
+        /// @brief Principal variations of the running search.
+        PV_table pv;
+
+        /// @brief Principal variation of the last search.
+        std::vector<uint64_t> last_pv;
+
+        /**
+         * @brief Searches all moves of the root state with full window.
+         * 
+         * @tparam COLOR The current player's color.
+         * @param state The root game state, the player at turn has to have a move.
+         * @param best_move Set to the best move found.
+         * @return The evaluated score of the root state relative to COLOR.
+         */
+        template <bool COLOR>
+        int search_root(const Board &state, uint64_t &best_move);
+
         /**
          * @brief Negascout search algorithm (a variant of alpha-beta pruning) used to find the best move.
          * 
+         * Written once in negamax form and specialized for the player at turn, the window
+         * and the score are relative to COLOR, see Engine::probe.
+         * 
+         * @tparam COLOR The current player's color (true for white, false for black).
          * @param state A pointer to the current game board state.
          * @param depth The maximum depth of the search tree.
-         * @param cur_color The current player's color (true for one color, false for the other).
+         * @param ply Distance from the root, passes do not count.
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
          * @param end_board Flag indicating whether the current board state is the final state.
-         * @return The evaluated score of the board.
+         * @return The evaluated score of the board relative to COLOR.
          */
-        int alphabeta(Board state, int depth, bool cur_color, int alpha, int beta, bool end_board);
+        template <bool COLOR>
+        int alphabeta(const Board &state, int depth, int ply, int alpha, int beta, bool end_board);
 
     public:
         /// @brief Constructor initializing settings. 
         explicit Alphabeta(Engine::Settings settings);
         
         uint64_t search(Board state, bool color) override;
+
+        void print_stats() const override;
+
+        std::vector<uint64_t> get_pv() const override;
 };
 
 #endif
\ No newline at end of file
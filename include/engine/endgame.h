@@ -0,0 +1,171 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "board/board.h"
+#include "engine/transposition_table.h"
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Exact endgame solver.
+ *
+ * Searches to the end of the game and returns the exact final disc
+ * differential, empty squares count for the winner. Nodes with many
+ * empties use negascout with transposition table and fastest-first
+ * move order. Last few empties are searched directly on bitmaps of
+ * the player at turn and the opponent, squares in regions with odd
+ * number of empties go first. Last 4 empties have their own routines
+ * which only count flips and do not generate move lists.
+ *
+ * Unlike the rest of the engines, the solver searches in negamax form,
+ * scores are relative to the player at turn.
+ * 
+ * The solve can be aborted by the engine's stop flag or by a deadline,
+ * both are checked by the nodes above the bitmap routines.
+ */
+class Endgame {
+    private:
+        /// @brief Nodes with fewer empties use the bitmap routines.
+        static constexpr int PARITY_EMPTIES = 6;
+
+        /// @brief Number of states between two reads of the clock.
+        static constexpr unsigned long long int CLOCK_INTERVAL = 4096;
+
+        /// @brief Mixed into the hash, so solved positions never mix with heuristic scores in the shared table.
+        static constexpr uint64_t ENDGAME_KEY = 0x9e3779b97f4a7c15;
+
+        /// @brief Quadrants of the board used for parity ordering.
+        static constexpr uint64_t QUADRANTS[4] = {
+            0x000000000f0f0f0f, 0x00000000f0f0f0f0,
+            0x0f0f0f0f00000000, 0xf0f0f0f000000000
+        };
+
+        /// @brief Transposition table shared with the engine, nullptr if disabled.
+        TranspositionTable *transposition_table;
+
+        /// @brief Stop flag of the engine, nullptr if the solve cannot be aborted.
+        const std::atomic<bool> *abort;
+
+        /// @brief Number of game states evaluated since the last reset.
+        unsigned long long int state_count;
+
+        /// @brief Time when the running solve is aborted.
+        std::chrono::steady_clock::time_point deadline;
+
+        /// @brief State count at which the clock is read next.
+        unsigned long long int next_clock_check;
+
+        /// @brief Set when the running solve reached the deadline.
+        bool timed_out;
+
+        /// @brief Checks the stop flag and once in a while the deadline, true if the solve has to be aborted.
+        bool stopped();
+
+        /**
+         * @brief Negascout over game states with transposition table.
+         *
+         * @param state Current game state.
+         * @param color Player at turn.
+         * @param alpha The alpha value, relative to the player at turn.
+         * @param beta The beta value, relative to the player at turn.
+         * @param passed True if the opponent passed the previous move.
+         * @return Final disc differential relative to the player at turn, only a bound outside of the window.
+         */
+        int search(const Board &state, bool color, int alpha, int beta, bool passed);
+
+        /**
+         * @brief Alpha-beta over bitmaps with parity move order.
+         *
+         * @param player Pieces of the player at turn.
+         * @param opponent Pieces of the opponent.
+         * @param empties Number of empty squares, more than 4.
+         * @param alpha The alpha value.
+         * @param beta The beta value.
+         * @param passed True if the opponent passed the previous move.
+         * @return Final disc differential, only a bound outside of the window.
+         */
+        int search_parity(uint64_t player, uint64_t opponent, int empties, int alpha, int beta, bool passed);
+
+        /// @brief Solves position with 4 empties, see search_parity.
+        int solve_4(uint64_t player, uint64_t opponent, int alpha, int beta, bool passed);
+
+        /// @brief Solves position with 3 empties, see search_parity.
+        int solve_3(uint64_t player, uint64_t opponent, int alpha, int beta, bool passed);
+
+        /// @brief Solves position with 2 empties, see search_parity.
+        int solve_2(uint64_t player, uint64_t opponent, int alpha, int beta, bool passed);
+
+        /**
+         * @brief Solves position with the last empty square.
+         *
+         * @param player Pieces of the player at turn.
+         * @param opponent Pieces of the opponent.
+         * @param square Bitmap of the empty square.
+         * @return Exact final disc differential.
+         */
+        int solve_1(uint64_t player, uint64_t opponent, uint64_t square);
+
+        /// @brief Bitmap of empty squares in quadrants with odd number of empties.
+        static uint64_t odd_quadrants(uint64_t empty);
+
+        /// @brief Final disc differential of finished game, empties go to the winner.
+        static int final_score(uint64_t player, uint64_t opponent);
+
+    public:
+        /**
+         * @brief Constructs solver sharing the engine's transposition table.
+         *
+         * @param transposition_table Table used above PARITY_EMPTIES, nullptr to search without it.
+         * @param abort Flag aborting the solve when set, results of aborted solve are invalid.
+         */
+        explicit Endgame(TranspositionTable *transposition_table, const std::atomic<bool> *abort = nullptr);
+
+        /**
+         * @brief Solves the root state.
+         *
+         * @param state The root game state, the player at turn has to have a move.
+         * @param color Player at turn.
+         * @param alpha The alpha value, white positive like the other engines.
+         * @param beta The beta value, white positive like the other engines.
+         * @param best_move Set to the best move found.
+         * @param deadline The solve is aborted when the time is reached, no limit by default.
+         * @return Final disc differential with white positive, only a bound outside of the window.
+         */
+        int solve(const Board &state, bool color, int alpha, int beta, uint64_t &best_move,
+                  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+        /// @brief True if the last solve was aborted by the stop flag or the deadline, its result is then invalid.
+        bool aborted() const;
+
+        /**
+         * @brief Best move of a solved state stored in the transposition table.
+         * 
+         * @param state The game state.
+         * @param color Player at turn.
+         * @return The stored move, 0 if the state is not in the table.
+         */
+        uint64_t stored_move(const Board &state, bool color);
+
+        /// @brief Number of game states evaluated by the last solve.
+        unsigned long long int get_state_count() const;
+};
+
+#endif
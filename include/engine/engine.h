@@ -20,6 +20,7 @@
 
 #include "board/board.h"
 #include "move_order.h"
+#include <vector>
 
 /**
  * @brief Class implementing game-tree search algorithms.
@@ -29,16 +30,33 @@ class Engine {
         /// @brief Engine search settings.
         struct Settings {
             int search_depth;
-            int time_limit;
+            int time_limit; // time limit per move in milliseconds, 0 for no limit
             int thread_count;
             bool transposition_enable;
+            int hash_size; // transposition table size in MB
+            bool prefetch_enable;
+            bool etc_enable; // enhanced transposition cutoffs at deep nodes
+            bool iid_enable; // internal iterative deepening at deep nodes without hash move
+            bool probcut_enable; // multi-probcut selective search, prunes by shallow search
+            int lmr_rank; // moves from this rank on are searched shallower first, 0 disables late move reductions
+            int lmr_min_depth; // nodes shallower than this never reduce moves
+            double lmr_divisor; // larger divisor reduces fewer moves by more than one ply
+            int lmr_max_reduction; // deepest reduction in plies
+            const char *hash_file; // transposition table snapshot file, nullptr if not used
+            int aspiration_window; // initial half-width of root search window, 0 for full window
+            int aspiration_growth; // factor widening the window after failed search
+            int endgame_empties; // number of empty squares at which exact endgame solver takes over, 0 disables it
+            bool endgame_wld; // endgame solver only decides win, loss or draw
+            bool ponder_enable; // search the expected position while the opponent thinks, play mode only
             const uint8_t *order;
         };
 
         /// @brief List of avaible algorithms.
         enum class Alg {
             ALPHABETA,
-            NEGASCOUT
+            NEGASCOUT,
+            LAZY_SMP,
+            MTDF
         };
 
         /// @brief Virtual deconstructor to ensure all derived classes can deleted properly.
@@ -54,9 +72,81 @@ class Engine {
          */
         virtual uint64_t search(Board state, bool color) = 0;
 
+        /**
+         * @brief Prints statistics of the last search.
+         * 
+         * Engines print their transposition table statistics, only in builds with TT_STATS defined.
+         */
+        virtual void print_stats() const {};
+
+        /**
+         * @brief Principal variation of the last search.
+         * 
+         * @return Moves expected from both players, starting with the returned move.
+         * Empty if the engine does not track it.
+         */
+        virtual std::vector<uint64_t> get_pv() const {return {};};
+
+        /**
+         * @brief Starts searching the given state in the background while the opponent thinks.
+         * 
+         * The search runs until ponder_hit or ponder_miss is called and fills the transposition
+         * table kept between moves. No other search may be started meanwhile.
+         * 
+         * @param state Game state after the expected reply of the opponent, the engine has to have a move.
+         * @param color The engine's color.
+         * @return True if the search started, false if the engine does not ponder.
+         */
+        virtual bool ponder(const Board &state, bool color) {(void)state; (void)color; return false;};
+
+        /**
+         * @brief The expected reply was played, the background search goes on within the time limit.
+         * 
+         * @return The best move in the pondered state.
+         */
+        virtual uint64_t ponder_hit() {return 0;};
+
+        /// @brief Other reply was played, the background search is aborted, the transposition table keeps its results.
+        virtual void ponder_miss() {};
+
     protected:
+        /// @brief Iterations shallower than this always search with full window.
+        static constexpr int ASPIRATION_MIN_DEPTH = 4;
+
+        /// @brief Nodes shallower than this use only the static move order, sorting by history does not pay off there.
+        static constexpr int HISTORY_MIN_DEPTH = 4;
+
         /// @brief Loaded search settings.
         Settings settings;
+
+        /// @brief Turns white positive score to the point of view of the player at turn, and back.
+        template <bool COLOR>
+        static constexpr int relative(int score) {return COLOR ? score : -score;};
+
+        /**
+         * @brief Probes transposition table from a search kernel in negamax form.
+         * 
+         * The table keeps white positive scores shared by all engines,
+         * for black the window and the score are turned around.
+         * 
+         * @return Score relative to the player at turn, NOT_FOUND if the entry does not cut the node off.
+         */
+        template <bool COLOR, typename Table>
+        static int probe(Table &table, uint64_t hash, const Board &state, int alpha, int beta, int depth, uint64_t &best_move) {
+            int score = COLOR ? table.get(hash, state, alpha, beta, depth, best_move) : table.get(hash, state, -beta, -alpha, depth, best_move);
+            return score == Table::NOT_FOUND ? score : relative<COLOR>(score);
+        };
+
+        /// @brief Stores score relative to the player at turn and its window into transposition table, see probe.
+        template <bool COLOR, typename Table>
+        static void store(Table &table, uint64_t hash, const Board &state, int score, int alpha, int beta, int depth, uint64_t best_move) {
+            if (COLOR) {
+                table.insert(hash, state, score, alpha, beta, depth, best_move);
+            }
+            else {
+                table.insert(hash, state, -score, -beta, -alpha, depth, best_move);
+            }
+        };
 };
 
 #endif
@@ -0,0 +1,152 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef LAZY_SMP_H
+#define LAZY_SMP_H
+
+#include "engine/engine.h"
+#include "engine/move_order.h"
+#include "engine/move_history.h"
+#include "engine/transposition_table.h"
+#include "engine/pv_table.h"
+#include "utils/thread_manager.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief Class implementing parallel negascout search with lazy SMP.
+ *
+ * Every thread runs the whole iterative deepening negascout from the root.
+ * Threads communicate only through one shared lock-free transposition table,
+ * results of one thread cut off parts of the tree for the others. To keep
+ * threads from searching the same nodes in lockstep, half of the helper
+ * threads search one ply deeper and use alternate move order, and helpers
+ * rotate the root moves.
+ *
+ * The search ends when the main thread completes its last iteration or the
+ * time runs out. The best move of the deepest iteration completed by any
+ * thread is returned.
+ */
+class LazySMP : public Engine {
+    private:
+        /// @brief Search state of one thread.
+        struct Worker {
+            /// @brief Index of the thread, 0 is the main thread.
+            int id;
+            /// @brief Move order used by the thread.
+            const Move_order *move_order;
+            /// @brief Number of game states evaluated in the last search.
+            unsigned long long int state_count;
+            /// @brief Best move of the deepest completed iteration.
+            uint64_t best_move;
+            /// @brief Score of the deepest completed iteration.
+            int best_eval;
+            /// @brief Depth of the deepest completed iteration.
+            int completed_depth;
+            /// @brief Root game state.
+            Board root;
+            /// @brief Color of the player at turn in the root state.
+            bool color;
+            /// @brief Engine the thread belongs to.
+            LazySMP *obj;
+            /// @brief Killer moves and history scores of the thread.
+            Move_history history;
+            /// @brief Principal variations of the running iteration.
+            PV_table pv;
+            /// @brief Principal variation of the deepest completed iteration.
+            std::vector<uint64_t> line;
+        };
+
+        /// @brief Array storing the order in which possible moves are evaluated to optimize search performance.
+        Move_order move_order;
+
+        /// @brief Different order used by half of the helper threads.
+        Move_order alternate_order;
+
+        /// @brief The transposition table shared by all threads.
+        TranspositionTableParallel transposition_table;
+
+        /// @brief Helper threads, main thread searches too.
+        ThreadManager manager;
+
+        /// @brief Search state of all threads.
+        std::vector<Worker> workers;
+
+        /// @brief Time when the running search has to stop.
+        std::chrono::steady_clock::time_point deadline;
+
+        /// @brief True if the main thread checks the deadline.
+        bool time_control;
+
+        /// @brief Set when the search has to end, shared by all threads.
+        std::atomic<bool> stop;
+
+        /// @brief Principal variation of the thread whose move was returned by the last search.
+        std::vector<uint64_t> last_pv;
+
+        /// @brief Runs iterative deepening of one helper thread.
+        static void search_thread(void *args);
+
+        /**
+         * @brief Runs iterative deepening of one thread.
+         *
+         * @param worker Search state of the thread.
+         * @param start Time when the search started.
+         */
+        void iterative_deepening(Worker &worker, std::chrono::steady_clock::time_point start);
+
+        /// @brief Searches one iteration with aspiration window, see Negascout::search_aspiration.
+        int search_aspiration(Worker &worker, int depth, int guess, uint64_t first_move, uint64_t &best_move);
+
+        /// @brief Searches all moves of the root state to the given depth, see Negascout::search_root.
+        int search_root(Worker &worker, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move);
+
+        /// @brief Root search specialized for the player at turn, window and score are relative to COLOR.
+        template <bool COLOR>
+        int search_root(Worker &worker, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move);
+
+        /**
+         * @brief Negascout search algorithm (a variant of alpha-beta pruning) used to find the best move.
+         *
+         * Negamax form specialized for the player at turn, see Negascout::negascout.
+         *
+         * @tparam COLOR The current player's color (true for white, false for black).
+         * @param worker Search state of the calling thread.
+         * @param state A pointer to the current game board state.
+         * @param depth The maximum depth of the search tree.
+         * @param ply Distance from the root, passes do not count.
+         * @param alpha The alpha value for alpha-beta pruning.
+         * @param beta The beta value for alpha-beta pruning.
+         * @param end_board Flag indicating whether the current board state is the final state.
+         * @return The evaluated score of the board relative to COLOR.
+         */
+        template <bool COLOR>
+        int negascout(Worker &worker, const Board &state, int depth, int ply, int alpha, int beta, bool end_board);
+
+    public:
+        /// @brief Constructor initializing settings and helper threads.
+        explicit LazySMP(Engine::Settings settings);
+
+        uint64_t search(Board state, bool color) override;
+
+        void print_stats() const override;
+
+        std::vector<uint64_t> get_pv() const override;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef MOVE_HISTORY_H
+#define MOVE_HISTORY_H
+
+#include "board/board.h"
+#include "engine/move_order.h"
+#include <cstdint>
+
+/**
+ * @brief Dynamic move ordering learned from beta cutoffs.
+ * 
+ * Keeps two killer moves for every ply and history score for every
+ * side and square. Moves which caused cutoff in sibling subtrees are
+ * likely to cause cutoff again, so they are searched sooner. Moves
+ * without killer or history score keep the static Move_order.
+ * 
+ * Not threadsafe, every search thread has its own instance.
+ */
+class Move_history {
+    private:
+        /// @brief Score of the first killer move, above any history score.
+        static constexpr uint32_t KILLER_SCORE = 1u << 30;
+
+        /// @brief Score of the second killer move.
+        static constexpr uint32_t KILLER2_SCORE = 1u << 29;
+
+        /// @brief History scores are halved once one of them gets over this limit.
+        static constexpr uint32_t HISTORY_LIMIT = 1u << 28;
+
+        /**
+         * @brief Two killer moves for every ply.
+         * 
+         * Ply is the number of pieces on the board, so killers stay valid
+         * between iterations and passes share the slot of their parent.
+         */
+        uint64_t killers[65][2];
+
+        /// @brief History score indexed by side (true for white) and square.
+        uint32_t history[2][64];
+
+        /// @brief Halves all history scores.
+        void age();
+
+    public:
+        /// @brief Initializes empty tables.
+        Move_history();
+
+        /// @brief Forgets killers and ages history before a new search.
+        void new_search();
+
+        /**
+         * @brief Records move which caused beta cutoff.
+         * 
+         * @param state Game state the move was played from.
+         * @param color Player who played the move.
+         * @param move The move.
+         * @param depth Remaining depth of the node, deeper cutoffs weigh more.
+         */
+        void update(const Board &state, bool color, uint64_t move, int depth);
+
+        /**
+         * @brief Lists possible moves in the order in which they should be searched.
+         * 
+         * First move goes first, then killers and moves with higher history score,
+         * moves with the same score keep the static order.
+         * 
+         * @param order Static order used as a tiebreak.
+         * @param state Current game state.
+         * @param color Player at turn.
+         * @param possible_moves Bitmap of all possible moves.
+         * @param first_move Move searched before all others (e.g. from transposition table), 0 if none.
+         * @param moves Output array with space for at least 64 moves.
+         * @return Number of moves written into the array.
+         */
+        int sort(const Move_order &order, const Board &state, bool color, uint64_t possible_moves, uint64_t first_move, uint64_t *moves) const;
+};
+
+#endif
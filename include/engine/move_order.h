@@ -94,6 +94,16 @@ class Move_order {
          */
         explicit Move_order(const std::vector<uint8_t>& order);
 
+        /**
+         * @brief Lists possible moves in the order in which they should be searched.
+         * 
+         * @param possible_moves Bitmap of all possible moves.
+         * @param first_move Move searched before all others (e.g. from transposition table), 0 if none.
+         * @param moves Output array with space for at least 64 moves.
+         * @return Number of moves written into the array.
+         */
+        int sort(uint64_t possible_moves, uint64_t first_move, uint64_t *moves) const;
+
         /// @brief Begin iterator (points to the first element of the array)
         const uint64_t* begin() const {
             return move_order;
@@ -0,0 +1,130 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef MTDF_H
+#define MTDF_H
+
+#include "engine/engine.h"
+#include "engine/move_order.h"
+#include "engine/move_history.h"
+#include "engine/transposition_table.h"
+#include <chrono>
+
+/**
+ * @brief Class implementing MTD(f) game-tree search.
+ * 
+ * Every iteration of iterative deepening finds the score by a sequence of
+ * null window alpha-beta searches. Each pass proves the score lies above
+ * or below a test value and the bounds close in on the score, starting
+ * from the guess given by the previous iterations. Passes search mostly
+ * the same tree, so the transposition table carries the work of one pass
+ * to the next and the search is only efficient with the table enabled.
+ * 
+ * Uses the same iterative deepening and time control as Negascout.
+ */
+class Mtdf : public Engine {
+    private:
+        /// @brief Number of heuristic evaluations performed in the last search (used for statistics).
+        unsigned long long int last_heuristic_count;
+
+        /// @brief Number of game states evaluated in the last search (used for statistics).
+        unsigned long long int last_state_count;
+
+        /// @brief Number of heuristic evaluations performed in the lifetime of class instance (used for statistics).
+        unsigned long long int total_heuristic_count;
+
+        /// @brief Number of game states evaluated in the lifetime of class instance (used for statistics).
+        unsigned long long int total_state_count;
+
+        /// @brief Number of null window passes in the last search (used for statistics).
+        unsigned long long int last_pass_count;
+
+        /// @brief Array storing the order in which possible moves are evaluated to optimize search performance.
+        Move_order move_order;
+
+        /// @brief Killer moves and history scores, searched before the static order.
+        Move_history move_history;
+
+        /// @brief The transposition table keeping the bounds found by the passes.
+        TranspositionTable transposition_table;
+
+        /// @brief Time when the running search has to stop.
+        std::chrono::steady_clock::time_point deadline;
+
+        /// @brief True if the running search checks the deadline.
+        bool time_control;
+
+        /// @brief Set when the deadline is reached, results of unfinished iteration are then invalid.
+        bool stop;
+
+        /**
+         * @brief Finds the score of one iteration by null window passes.
+         * 
+         * @param state The root game state.
+         * @param color The current player's color.
+         * @param depth Search depth of the iteration.
+         * @param guess Expected score, the first pass tests it.
+         * @param first_move Move searched first, usually best move of previous iteration.
+         * @param best_move Set to the best move found.
+         * @return The evaluated score of the root state.
+         */
+        int search_mtdf(const Board &state, bool color, int depth, int guess, uint64_t first_move, uint64_t &best_move);
+
+        /**
+         * @brief Searches all moves of the root state with null window.
+         * 
+         * @param state The root game state.
+         * @param color The current player's color.
+         * @param depth Search depth of the iteration.
+         * @param beta Test value, the pass proves the score is at least beta or lower than beta.
+         * @param first_move Move searched first.
+         * @param best_move Set to the move proving the bound good for the player at turn, untouched otherwise.
+         * @return Bound of the score of the root state.
+         */
+        int search_root(const Board &state, bool color, int depth, int beta, uint64_t first_move, uint64_t &best_move);
+
+        /// @brief Root pass specialized for the player at turn, test value and score are relative to COLOR, see search_root.
+        template <bool COLOR>
+        int search_root(const Board &state, int depth, int beta, uint64_t first_move, uint64_t &best_move);
+
+        /**
+         * @brief Fail-soft alpha-beta with transposition table, called with null window by the passes.
+         * 
+         * Written once in negamax form and specialized for the player at turn, the window
+         * and the score are relative to COLOR, see Engine::probe.
+         * 
+         * @tparam COLOR The current player's color (true for white, false for black).
+         * @param state A pointer to the current game board state.
+         * @param depth The maximum depth of the search tree.
+         * @param alpha The alpha value for alpha-beta pruning.
+         * @param beta The beta value for alpha-beta pruning.
+         * @param end_board Flag indicating whether the current board state is the final state.
+         * @return The evaluated score of the board relative to COLOR, only a bound outside of the window.
+         */
+        template <bool COLOR>
+        int alphabeta(const Board &state, int depth, int alpha, int beta, bool end_board);
+
+    public:
+        /// @brief Constructor initializing settings.
+        explicit Mtdf(Engine::Settings settings);
+
+        uint64_t search(Board state, bool color) override;
+
+        void print_stats() const override;
+};
+
+#endif
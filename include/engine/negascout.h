@@ -20,9 +20,19 @@
 
 #include "engine/engine.h"
 #include "engine/move_order.h"
+#include "engine/move_history.h"
 #include "engine/transposition_table.h"
+#include "engine/endgame.h"
+#include "engine/probcut.h"
+#include "engine/pv_table.h"
 #include "utils/thread_manager.h"
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <future>
+#include <sstream>
+#include <vector>
 
 // IMPORTANT
 // parallel class is completely separate in orded
@@ -30,6 +40,31 @@
 
 /**
  * @brief Class implementing negascout game-tree search.
+ * 
+ * The search is iterative deepening, it deepens one ply at a time up to the
+ * search depth. Every iteration fills the transposition table and its best
+ * move is searched first by the next one. With time limit set, the search
+ * stops when the time runs out and returns the best move of the deepest
+ * completed iteration.
+ * 
+ * Positions with at most Settings::endgame_empties empty squares are
+ * solved exactly by the endgame solver instead, the score is then the
+ * final disc differential. With Settings::endgame_wld the solver searches
+ * only window (-1, 1), the score then tells just win, loss or draw.
+ * 
+ * With Settings::probcut_enable, deep nodes are first searched shallow
+ * with null windows and pruned when the shallow score predicts the deep
+ * score lies outside of the window, see ProbCut.
+ * 
+ * With Settings::lmr_rank, moves ordered late are searched with null
+ * window shallower first and searched again at full depth only when they
+ * beat the bound. The reduction grows with depth and rank, its shape is
+ * set by Settings::lmr_min_depth, lmr_divisor and lmr_max_reduction.
+ * 
+ * With Settings::ponder_enable, the engine searches the state after the
+ * expected reply on a background thread while the opponent thinks. The
+ * search has no time limit until the reply is known. On ponder hit it goes
+ * on until the time limit counted from its start, on ponder miss it is aborted.
  */
 class Negascout : public Engine {
     private:
@@ -44,91 +79,365 @@ class Negascout : public Engine {
 
         /// @brief Number of game states evaluated in the lifetime of class instance (used for statistics).
         unsigned long long int total_state_count;
+
+        /// @brief Number of root searches repeated with wider aspiration window in the last search (used for statistics).
+        unsigned long long int last_research_count;
+
+        /// @brief Number of nodes cut off by a child found in transposition table in the last search (used for statistics).
+        unsigned long long int last_etc_count;
+
+        /// @brief Number of nodes pruned by probcut in the last search (used for statistics).
+        unsigned long long int last_probcut_count;
+
+        /// @brief Nodes shallower than this skip enhanced transposition cutoffs.
+        static constexpr int ETC_MIN_DEPTH = 5;
+
+        /// @brief Nodes without hash move from this depth on search shallower first to find one.
+        static constexpr int IID_MIN_DEPTH = 4;
+
+        /// @brief Depth of the internal iterative deepening search is lower by this.
+        static constexpr int IID_REDUCTION = 2;
+
+        /// @brief Number of internal iterative deepening searches in the last search (used for statistics).
+        unsigned long long int last_iid_count;
+
+        /// @brief Reduction indexed by depth and rank of the move, 0 for moves searched at full depth, built from the lmr settings.
+        uint8_t lmr_table[64][64];
+
+        /// @brief Number of reduced searches which had to be repeated at full depth in the last search (used for statistics).
+        unsigned long long int last_lmr_research_count;
         
         /// @brief Array storing the order in which possible moves are evaluated to optimize search performance.
         Move_order move_order;
 
+        /// @brief Killer moves and history scores, searched before the static order.
+        Move_history move_history;
+
         /// @brief The transposition table used to store previously evaluated game states and their results, improving search efficiency.
         TranspositionTable transposition_table;
 
+        /// @brief Exact solver used near the end of the game, shares the transposition table.
+        Endgame endgame;
+
+        /// @brief Principal variations of the running search.
+        PV_table pv;
+
+        /// @brief Principal variation of the last completed iteration.
+        std::vector<uint64_t> last_pv;
+
+        /// @brief Time when the running search has to stop.
+        std::chrono::steady_clock::time_point deadline;
+
+        /// @brief True if the running search checks the deadline.
+        bool time_control;
+
+        /// @brief Set when the deadline is reached or pondering is aborted, results of unfinished iteration are then invalid.
+        std::atomic<bool> stop;
+
+        /// @brief Best move of the background search, valid while pondering.
+        std::future<uint64_t> ponder_result;
+
+        /// @brief Statistics of the background search, printed only on ponder hit.
+        std::ostringstream ponder_output;
+
+        /// @brief State searched in the background.
+        Board ponder_state;
+
+        /// @brief The engine's color in the pondered state.
+        bool ponder_color;
+
+        /// @brief Time when the background search started.
+        std::chrono::steady_clock::time_point ponder_start;
+
+        /**
+         * @brief Iterative deepening from the root state, see search.
+         * 
+         * @param state The root game state.
+         * @param color The current player's color.
+         * @param pondering True for background search, it ignores the time limit and ends at search depth or when stopped.
+         * @param out Stream the statistics are printed to.
+         * @return The best move as a bitboard, 0 if no iteration completed.
+         */
+        uint64_t run_search(Board state, bool color, bool pondering, std::ostream &out);
+
+        /**
+         * @brief Searches one iteration with aspiration window centered on the guessed score.
+         * 
+         * @param state The root game state.
+         * @param color The current player's color.
+         * @param depth Search depth of the iteration.
+         * @param guess Expected score, usually score of previous iteration.
+         * @param first_move Move searched first, usually best move of previous iteration.
+         * @param best_move Set to the best move found.
+         * @return The evaluated score of the root state.
+         * 
+         * Window is widened by Settings::aspiration_growth on the failing side and
+         * the search is repeated until the score fits in. Shallow iterations and
+         * disabled aspiration (Settings::aspiration_window = 0) use full window.
+         */
+        int search_aspiration(const Board &state, bool color, int depth, int guess, uint64_t first_move, uint64_t &best_move);
+
+        /**
+         * @brief Searches all moves of the root state to the given depth.
+         * 
+         * @param state The root game state.
+         * @param color The current player's color.
+         * @param depth Search depth of the iteration.
+         * @param alpha The alpha value of the root window.
+         * @param beta The beta value of the root window.
+         * @param first_move Move searched first, usually best move of previous iteration.
+         * @param best_move Set to the best move found.
+         * @return The evaluated score of the root state, only a bound if it falls outside of the window.
+         */
+        int search_root(const Board &state, bool color, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move);
+
+        /// @brief Root search specialized for the player at turn, window and score are relative to COLOR, see search_root.
+        template <bool COLOR>
+        int search_root(const Board &state, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move);
+
         /**
          * @brief Negascout search algorithm (a variant of alpha-beta pruning) used to find the best move.
          * 
+         * Written once in negamax form and specialized for the player at turn, the window
+         * and the score are relative to COLOR. The transposition table keeps white positive
+         * scores, see Engine::probe.
+         * 
+         * @tparam COLOR The current player's color (true for white, false for black).
          * @param state A pointer to the current game board state.
          * @param depth The maximum depth of the search tree.
-         * @param cur_color The current player's color (true for one color, false for the other).
+         * @param ply Distance from the root, passes do not count.
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
          * @param end_board Flag indicating whether the current board state is the final state.
-         * @return The evaluated score of the board.
+         * @return The evaluated score of the board relative to COLOR.
          */
-        int negascout(Board state, int depth, bool cur_color, int alpha, int beta, bool end_board);
+        template <bool COLOR>
+        int negascout(const Board &state, int depth, int ply, int alpha, int beta, bool end_board);
+
+        /**
+         * @brief Tries to prune the node by shallow null window searches.
+         * 
+         * @tparam COLOR Color of the player at turn.
+         * @param state Game state of the node.
+         * @param depth Remaining depth of the node.
+         * @param ply Distance of the node from the root.
+         * @param alpha The alpha value of the node, relative to COLOR.
+         * @param beta The beta value of the node, relative to COLOR.
+         * @param eval Set to the bound returned by the node if it is pruned.
+         * @return True if the node is pruned.
+         */
+        template <bool COLOR>
+        bool probcut(const Board &state, int depth, int ply, int alpha, int beta, int &eval);
 
     public:
         /// @brief Constructor initializing settings. 
         explicit Negascout(Engine::Settings settings);
 
+        /// @brief Aborts the background search if the engine still ponders.
+        ~Negascout() override;
+
+        /**
+         * @brief Searches the state to the given depth with full window, without time limit and output.
+         * 
+         * Used to calibrate probcut, scores of consecutive depths reuse the transposition table.
+         * 
+         * @param state The root game state, the player at turn has to have a move.
+         * @param color The current player's color.
+         * @param depth Search depth.
+         * @param best_move Set to the best move found.
+         * @return The exact score of the state with white positive.
+         */
+        int search_fixed(const Board &state, bool color, int depth, uint64_t &best_move);
+
         uint64_t search(Board state, bool color) override;
+
+        void print_stats() const override;
+
+        std::vector<uint64_t> get_pv() const override;
+
+        bool ponder(const Board &state, bool color) override;
+
+        uint64_t ponder_hit() override;
+
+        void ponder_miss() override;
 };
 
 /**
- * @brief Class implementing negascout game-tree search.
+ * @brief Class implementing parallel negascout game-tree search.
+ * 
+ * Uses Young Brothers Wait splitting. Once the eldest child of a node is
+ * searched, the remaining children become a split point, idle threads join
+ * it and search the younger brothers with the shared bounds. A cutoff found
+ * by any thread aborts all threads working below the split point. The owner
+ * of a split point helps with split points below its own while it waits for
+ * the helpers to finish.
  * 
- * This version is experimental parallel version. Searching in parallel
- * introduces significant overhead, since parallel search has a huge
- * impact on pruning performance. Does not scale past 2-4 cores with only
- * small 10%-20% performance improvements over single threaded version.
+ * Uses the same iterative deepening and time control as Negascout.
  */
 class NegascoutParallel : public Engine {
     private:
+        /// @brief Nodes shallower than this are always searched by one thread.
+        static constexpr int SPLIT_MIN_DEPTH = 4;
+
+        /// @brief Node whose remaining moves are searched by several threads.
+        struct SplitPoint {
+            /// @brief Game state of the node.
+            const Board *state;
+            /// @brief Remaining depth of the node.
+            int depth;
+            /// @brief Color of the player at turn, the bounds and scores are relative to it.
+            bool cur_color;
+            /// @brief Moves of the node, owned by the thread which created the split point.
+            const uint64_t *moves;
+            /// @brief Number of moves.
+            int move_count;
+            /// @brief Index of the next move nobody searches yet.
+            std::atomic<int> next_move;
+            /// @brief Guards the bounds and the best move.
+            std::mutex m;
+            /// @brief Shared alpha value.
+            int alpha;
+            /// @brief Shared beta value.
+            int beta;
+            /// @brief Best score found so far.
+            int best_eval;
+            /// @brief Move with the best score.
+            uint64_t best_move;
+            /// @brief Set when the node fails high, all threads below stop searching.
+            std::atomic<bool> cutoff;
+            /// @brief Number of threads searching moves besides the owner.
+            std::atomic<int> helper_count;
+            /// @brief Split point the node lies under, nullptr for the top one.
+            SplitPoint *parent;
+        };
+
+        /// @brief Search state of one thread.
+        struct Worker {
+            /// @brief Number of game states evaluated in the last search.
+            unsigned long long int state_count;
+            /// @brief Innermost split point the thread is searching under.
+            SplitPoint *split;
+            /// @brief Engine the thread belongs to.
+            NegascoutParallel *obj;
+            /// @brief Killer moves and history scores of the thread.
+            Move_history history;
+        };
+
         /// @brief Array storing the order in which possible moves are evaluated to optimize search performance.
         Move_order move_order;
 
         /// @brief The transposition table used to store previously evaluated game states and their results, improving search efficiency.
         TranspositionTableParallel transposition_table;
 
-        /// @brief Mutex for accessing shared resources during search.
-        std::mutex m;
-
-        /// @brief Thread manager engine.
+        /// @brief Helper threads, main thread searches too.
         ThreadManager manager;
 
+        /// @brief Search state of all threads, main thread is the first one.
+        std::vector<Worker> workers;
+
+        /// @brief Guards the list of open split points.
+        std::mutex split_mutex;
+
+        /// @brief Wakes up idle helpers when there is new work or the search ends.
+        std::condition_variable split_cond;
+
+        /// @brief Split points with moves left to search.
+        std::vector<SplitPoint*> open_splits;
+
+        /// @brief Number of helpers waiting for work.
+        std::atomic<int> idle_count;
+
+        /// @brief Set when the root search is over and helpers should return.
+        bool search_done;
+
+        /// @brief Time when the running search has to stop.
+        std::chrono::steady_clock::time_point deadline;
+
+        /// @brief True if the running search checks the deadline.
+        bool time_control;
+
+        /// @brief Set when the deadline is reached, shared by all threads.
+        std::atomic<bool> stop;
+
+        /// @brief Searches one iteration with aspiration window, see Negascout::search_aspiration.
+        int search_aspiration(const Board &state, bool color, int depth, int guess, uint64_t first_move, uint64_t &best_move);
+
+        /// @brief Searches all moves of the root state to the given depth, see Negascout::search_root.
+        int search_root(const Board &state, bool color, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move);
+
+        /// @brief Root search specialized for the player at turn, window and score are relative to COLOR.
+        template <bool COLOR>
+        int search_root(const Board &state, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move);
+
         /**
          * @brief Negascout search algorithm (a variant of alpha-beta pruning) used to find the best move.
          * 
+         * Negamax form specialized for the player at turn, see Negascout::negascout.
+         * 
+         * @tparam COLOR The current player's color (true for white, false for black).
+         * @param worker Search state of the calling thread.
          * @param state A pointer to the current game board state.
          * @param depth The maximum depth of the search tree.
-         * @param cur_color The current player's color (true for one color, false for the other).
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
          * @param end_board Flag indicating whether the current board state is the final state.
-         * @return The evaluated score of the board.
+         * @return The evaluated score of the board relative to COLOR.
          */
-        int negascout(Board state, int depth, bool cur_color, int alpha, int beta, bool end_board);
+        template <bool COLOR>
+        int negascout(Worker &worker, const Board &state, int depth, int alpha, int beta, bool end_board);
 
-        /// @brief Struct used to pass arguments to threaded search_move function.
-        struct SearchArg {
-            Board state;
-            uint64_t move;
-            bool cur_color;
-            int *alpha;
-            int *beta;
-            int ret;
-            NegascoutParallel *obj;
-        };
+        /**
+         * @brief Searches the remaining moves of a node together with idle threads.
+         * 
+         * Returns after all moves are searched or the node fails high,
+         * the bounds and the best move are updated with the results.
+         * 
+         * @param worker Search state of the calling thread.
+         * @param state Game state of the node.
+         * @param depth Remaining depth of the node.
+         * @param cur_color Color of the player at turn, the bounds and scores are relative to it.
+         * @param moves Moves which are not searched yet.
+         * @param move_count Number of the moves.
+         * @param alpha The alpha value of the node.
+         * @param beta The beta value of the node.
+         * @param best_eval Best score of the node.
+         * @param best_move Move with the best score.
+         */
+        void split(Worker &worker, const Board &state, int depth, bool cur_color, const uint64_t *moves, int move_count, int &alpha, int &beta, int &best_eval, uint64_t &best_move);
+
+        /// @brief Searches moves of the split point until there are none left or the search is aborted.
+        void search_split(Worker &worker, SplitPoint &sp);
+
+        /// @brief Split point search specialized for the player at turn, see search_split.
+        template <bool COLOR>
+        void search_split(Worker &worker, SplitPoint &sp);
 
         /**
-         * @brief Searches one move, used by parallel engine.
+         * @brief Waits for work and joins open split points.
          * 
-         * Threadsafe.
+         * @param worker Search state of the calling thread.
+         * @param master Split point whose owner is waiting for its helpers, only
+         * split points below it are joined and the function returns once it has no helpers.
+         * nullptr for helper threads, which return when the search ends.
          */
-        static void search_move(void *args);
+        void idle_loop(Worker &worker, SplitPoint *master);
+
+        /// @brief Finds an open split point with moves left below master, caller holds split_mutex.
+        SplitPoint *find_split(const SplitPoint *master) const;
+
+        /// @brief True if the time is up or a split point above the thread failed high.
+        bool aborted(const Worker &worker) const;
+
+        /// @brief Runs idle loop of one helper thread.
+        static void helper_thread(void *args);
 
     public:
         /// @brief Constructor initializing settings. 
         explicit NegascoutParallel(Engine::Settings settings);
 
         uint64_t search(Board state, bool color) override;
+
+        void print_stats() const override;
 };
 
 #endif
@@ -0,0 +1,87 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef PROBCUT_H
+#define PROBCUT_H
+
+#include "board/board.h"
+#include "engine/engine.h"
+
+/**
+ * @brief Parameters of Multi-ProbCut selective search.
+ *
+ * Score of deep search is predicted from score of shallow search by
+ * linear regression deep = a * shallow + b with standard deviation sigma
+ * of the error. Separate parameters are fitted for every game stage and
+ * every depth, so the cut can be tried at many depths of the tree.
+ * Scores are relative to the player at turn.
+ *
+ * Parameters are fitted offline by calibrate() and pasted into the table.
+ */
+class ProbCut {
+    public:
+        /// @brief Regression parameters of one stage and depth.
+        struct Params {
+            float a;
+            float b;
+            float sigma;
+        };
+
+        /// @brief Shallowest node where the cut is tried.
+        static constexpr int MIN_DEPTH = 4;
+
+        /// @brief Deepest node where the cut is tried.
+        static constexpr int MAX_DEPTH = 14;
+
+        /// @brief Number of game stages, stage is given by the number of pieces on the board.
+        static constexpr int STAGE_COUNT = 6;
+
+        /// @brief Number of standard deviations the shallow score must be outside of the window.
+        static constexpr float THRESHOLD = 2.0f;
+
+        /// @brief Depth of the shallow search predicting search of the given depth.
+        static int shallow_depth(int depth) {
+            return depth / 2;
+        }
+
+        /**
+         * @brief Finds parameters for the node.
+         *
+         * @param state Game state of the node.
+         * @param depth Remaining depth of the node.
+         * @return Parameters, nullptr if the cut should not be tried.
+         */
+        static const Params *get(const Board &state, int depth);
+
+        /**
+         * @brief Fits the parameters from negascout searches on positions of self-play games.
+         *
+         * Prints the table in the form used in probcut.cpp.
+         *
+         * @param settings Engine settings, search depth is the deepest calibrated depth.
+         */
+        static void calibrate(Engine::Settings settings);
+
+    private:
+        /// @brief Calibrated parameters indexed by stage and depth, zero sigma disables the cut.
+        static const Params PARAMS[STAGE_COUNT][MAX_DEPTH + 1];
+
+        /// @brief Game stage of the state.
+        static int stage(const Board &state);
+};
+
+#endif
@@ -0,0 +1,161 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef PV_TABLE_H
+#define PV_TABLE_H
+
+#include "board/board.h"
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Triangular table of principal variations.
+ * 
+ * Row of every ply holds the best line found below the node searched at
+ * that ply. When a move scores inside the window, the node's row becomes
+ * the move followed by the row of the next ply, so the root row ends up
+ * with the principal variation. Passes are not stored, the node after
+ * a pass is searched at the same ply as the node which passed.
+ * 
+ * Line of the previous iteration is followed by the next one, nodes on
+ * the line search its move first. Lines end early where the search was
+ * cut off by the transposition table, engines may extend them by moves
+ * stored in the table.
+ */
+class PV_table {
+    public:
+        /// @brief Deepest ply the table can hold.
+        static constexpr int MAX_PLY = 64;
+
+    private:
+        /// @brief Lines indexed by ply, row of ply p starts at column p.
+        uint64_t moves[MAX_PLY][MAX_PLY];
+
+        /// @brief End of the line of every row.
+        int length[MAX_PLY];
+
+        /// @brief Line of the previous iteration.
+        uint64_t previous[MAX_PLY];
+
+        /// @brief Length of the line of the previous iteration.
+        int previous_length;
+
+        /// @brief Nodes up to this ply lie on the previous line.
+        int follow;
+
+    public:
+        /// @brief Constructs empty table.
+        PV_table();
+
+        /// @brief Starts new search, the previous line is forgotten.
+        void new_search() {
+            previous_length = 0;
+            length[0] = 0;
+        }
+
+        /// @brief Starts new iteration, the line will be followed.
+        void new_iteration(const std::vector<uint64_t> &line) {
+            previous_length = std::min(static_cast<int>(line.size()), MAX_PLY);
+            for (int i = 0; i < previous_length; ++i) {
+                previous[i] = line[i];
+            }
+        }
+
+        /// @brief Starts new root search, also every repeated aspiration search.
+        void new_root() {
+            follow = 0;
+            length[0] = 0;
+        }
+
+        /// @brief Clears the row of a node entering search.
+        void clear(int ply) {
+            length[ply] = ply;
+        }
+
+        /// @brief Sets the row to the move followed by the row of the next ply.
+        void update(int ply, uint64_t move) {
+            moves[ply][ply] = move;
+            for (int i = ply + 1; i < length[ply + 1]; ++i) {
+                moves[ply][i] = moves[ply + 1][i];
+            }
+            length[ply] = length[ply + 1];
+        }
+
+        /// @brief Move of the previous line at the node, 0 if the node is off the line.
+        uint64_t first_move(int ply) const {
+            return follow >= ply && ply < previous_length ? previous[ply] : 0;
+        }
+
+        /// @brief Called before every child is searched, nodes below the move stay on the line only if the move is on it.
+        void follow_move(int ply, uint64_t move) {
+            if (follow >= ply) {
+                follow = ply < previous_length && move == previous[ply] ? ply + 1 : ply;
+            }
+        }
+
+        /// @brief Principal variation in the root row.
+        std::vector<uint64_t> line() const;
+
+        /**
+         * @brief Extends the line past transposition table cutoffs by the best moves stored in the table.
+         * 
+         * @param line The line to extend.
+         * @param state Root game state of the line.
+         * @param color Player at turn in the root state.
+         * @param depth Maximum length of the line.
+         * @param table Transposition table the line was searched with.
+         */
+        template <typename Table>
+        static void extend(std::vector<uint64_t> &line, Board state, bool color, int depth, Table &table);
+
+        /// @brief Formats the line as 'x,y' squares in the coordinates used by the terminal.
+        static std::string to_string(const std::vector<uint64_t> &line);
+};
+
+template <typename Table>
+void PV_table::extend(std::vector<uint64_t> &line, Board state, bool color, int depth, Table &table) {
+    for (uint64_t move : line) {
+        if (state.find_moves(color) == 0) {
+            color = !color;
+        }
+        state.play_move(color, move);
+        color = !color;
+    }
+    while (static_cast<int>(line.size()) < depth) {
+        uint64_t possible_moves = state.find_moves(color);
+        if (possible_moves == 0) {
+            color = !color;
+            possible_moves = state.find_moves(color);
+            if (possible_moves == 0) {
+                break;
+            }
+        }
+        // no entry is this deep, the probe only fetches the stored move
+        uint64_t move = 0;
+        table.get(state.hash(color), state, -1000, 1000, MAX_PLY, move);
+        if ((move & possible_moves) == 0) {
+            break;
+        }
+        line.push_back(move);
+        state.play_move(color, move);
+        color = !color;
+    }
+}
+
+#endif
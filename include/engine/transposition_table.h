@@ -18,137 +18,404 @@
 #ifndef TRANSPOSITION_TABLE_H
 #define TRANSPOSITION_TABLE_H
 
+#include "board/board.h"
+#include "utils/huge_page_buffer.h"
 #include <cstdint>
-#include <unordered_map>
+#include <atomic>
 #include <vector>
-#include <mutex>
+
+// TT_STATS enables usage statistics of transposition tables,
+// TT_VERIFY additionally stores full boards to detect key collisions
+#if defined(TT_VERIFY) && !defined(TT_STATS)
+    #define TT_STATS
+#endif
 
 /**
  * @brief Class representing a transposition table for storing game states.
  * 
  * The Transposition_table class is used to store and retrieve game states
- * identified by their unique hash and alpha-beta values. It uses an internal
- * unordered map to maintain the mapping from hash values to their corresponding
- * entries.
+ * identified by their unique hash and alpha-beta values. Entries live in a
+ * fixed-size, power-of-two array of 64-byte buckets that is allocated once
+ * at construction (on huge pages when available), so probes never allocate
+ * and touch a single cache line.
+ * 
+ * Every bucket is split into two tiers. The first entry is depth-preferred,
+ * it is only replaced by results of at least as deep searches. The remaining
+ * entries form always-replace tier, where the shallowest entry is evicted.
+ * 
+ * The table is kept between searches. Each search has its own generation
+ * and entries from older generations are evicted first.
+ * 
+ * The table can be backed by a snapshot file, so it is kept even between
+ * runs of the program. The file starts with a header describing the format,
+ * snapshot with different format or size is discarded. Only one process
+ * can use the file at a time, the first one locks it and the others search
+ * with private table, see HugePageBuffer.
+ * 
+ * Builds with TT_STATS defined count probes, hits, cutoffs, stores,
+ * overwrites and key collisions of the last search. Release builds do not
+ * contain any of the counters.
  */
 class TranspositionTable {
+    // parallel table shares the entry format
+    friend class TranspositionTableParallel;
+
     private:    
-        /// @brief Structure representing an entry in the transposition table.
+        /**
+         * @brief Structure representing an entry in the transposition table.
+         * 
+         * Data word layout (low to high bits):
+         * 16 bits score, 8 bits depth, 2 bits entry type, 6 bits generation,
+         * 8 bits best move (position of the move + 1, 0 if none).
+         */
         struct Entry {
-            /// @brief The score associated with the game state.
-            int score;
-            /// @brief The type of the entry (exact, lower bound, upper bound).
-            int type;
+            /// @brief Full hash of the stored game state, used to verify the entry.
+            uint64_t key;
+            /// @brief Packed score, depth, type, generation and best move of the entry.
+            uint64_t data;
         };
 
-        /// @brief The internal map storing hash-entry pairs.
-        std::unordered_map<uint64_t, Entry> map;
+        /// @brief Number of entries sharing one cache line.
+        static constexpr int bucket_size = 4;
+
+        /// @brief Group of entries which fits exactly into one cache line.
+        struct alignas(64) Bucket {
+            Entry entries[bucket_size];
+        };
+
+        /// @brief Header at the start of the snapshot file.
+        struct SnapshotHeader {
+            /// @brief Identifies the file as a snapshot.
+            char magic[8];
+            /// @brief Version of the entry format.
+            uint32_t version;
+            /// @brief Nonzero if the keys are stored XORed with the data (parallel table).
+            uint32_t xor_keys;
+            /// @brief Fingerprint of the zobrist keys the table was filled with.
+            uint64_t key_scheme;
+            /// @brief Number of buckets in the file.
+            uint64_t bucket_count;
+            /// @brief Generation of the last search.
+            uint64_t generation;
+        };
+
+        /// @brief Space reserved for the header, keeps the buckets page aligned.
+        static constexpr uint64_t SNAPSHOT_HEADER_SIZE = 4096;
+
+        /// @brief Version of the entry format, has to be increased whenever the format changes.
+        static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+        /// @brief Computes number of buckets fitting into the memory budget, always power of two.
+        static uint64_t count_buckets(int size_mb);
+
+        /// @brief Computes size of the memory holding the buckets and optional snapshot header.
+        static uint64_t memory_size(uint64_t bucket_count, const char *snapshot_file);
+
+        /**
+         * @brief Checks header of the snapshot and prepares it for use.
+         * 
+         * @param memory Memory of the table, starting with the header.
+         * @param bucket_count Number of buckets of the table.
+         * @param xor_keys Key format of the table.
+         * @param generation Set to the generation of restored snapshot.
+         * @return true if restored entries can be used, false if the header was rewritten and the table has to start empty.
+         * 
+         * Keys stored in the other format are converted in place.
+         */
+        static bool open_snapshot(HugePageBuffer &memory, uint64_t bucket_count, bool xor_keys, int &generation);
+
+        /// @brief Packs score, entry type, depth, generation and best move into one data word.
+        static uint64_t pack(int score, int type, int depth, int generation, uint64_t move);
+
+        /// @brief Unpacks score from the data word.
+        static int unpack_score(uint64_t data);
+
+        /// @brief Unpacks entry type from the data word.
+        static int unpack_type(uint64_t data);
+
+        /// @brief Unpacks depth from the data word.
+        static int unpack_depth(uint64_t data);
+
+        /// @brief Unpacks generation from the data word.
+        static int unpack_generation(uint64_t data);
+
+        /// @brief Unpacks best move bitmap from the data word.
+        static uint64_t unpack_move(uint64_t data);
+
+        /// @brief Returns how valuable the entry is, the least valuable entry is replaced first.
+        static int keep_value(uint64_t data, int generation);
+
+        /// @brief Stores entry into the always-replace tier of the bucket, returns the used slot.
+        Entry *store_always(Bucket &bucket, uint64_t key, uint64_t data);
+
+        /// @brief Number of allocated buckets.
+        uint64_t bucket_count;
+
+        /// @brief Memory holding the buckets.
+        HugePageBuffer memory;
+
+        /// @brief Header of the snapshot file, nullptr if the table is not backed by file.
+        SnapshotHeader *snapshot;
+
+        /// @brief The internal array of buckets, size is always power of two.
+        Bucket *buckets;
+
+        /// @brief Mask selecting bucket index from the hash.
+        uint64_t bucket_mask;
+
+        /// @brief Generation of the current search (6 bits).
+        int generation;
+
+#ifdef TT_STATS
+        /// @brief Usage statistics of the last search.
+        struct Stats {
+            /// @brief Number of probes.
+            uint64_t probes;
+            /// @brief Number of probes which found entry of the state (at any depth).
+            uint64_t hits;
+            /// @brief Number of probes which returned usable score.
+            uint64_t cutoffs;
+            /// @brief Number of inserted entries.
+            uint64_t stores;
+            /// @brief Number of entries of other states evicted by insert.
+            uint64_t overwrites;
+            /// @brief Number of hits which belonged to a different board.
+            uint64_t collisions;
+        } stats;
+#endif
+
+#ifdef TT_VERIFY
+        /// @brief Board stored with the entry, used to detect key collisions. Boards are not saved to snapshot file, restored entries have empty board and are not verified.
+        struct StoredBoard {
+            uint64_t white;
+            uint64_t black;
+        };
+
+        /// @brief Boards of all entries, indexed the same way as entries.
+        std::vector<StoredBoard> boards;
+
+        /// @brief Returns index of the entry into array of boards.
+        uint64_t entry_index(const Entry *entry) const;
+#endif
 
     public:
         /// @brief Constant representing that entry was not found.
         static constexpr int NOT_FOUND = 1111;
 
+        /**
+         * @brief Allocates the table.
+         * 
+         * @param size_mb Memory budget in megabytes, rounded down to the nearest power of two.
+         * @param snapshot_file File the table is saved to and restored from, nullptr to keep it only in memory.
+         */
+        explicit TranspositionTable(int size_mb, const char *snapshot_file = nullptr);
+
         /// @brief Removes all entries stored in the transposition table.
         void clear();
 
+        /**
+         * @brief Starts new search generation.
+         * 
+         * Entries of previous searches stay usable, but are replaced first.
+         */
+        void new_search();
+
         /**
          * @brief Inserts a new entry into the transposition table.
          * 
          * @param hash The unique hash value identifying the game state.
+         * @param state The game state, only used to detect key collisions in TT_VERIFY builds.
          * @param score The score associated with the game state.
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
+         * @param depth The remaining search depth the score was computed with.
+         * @param best_move The best move found (or move which caused cutoff), 0 if none.
          * 
          * Score, alpha and beta values are used to determine entry type.
          */
-        void insert(uint64_t hash, int score, int alpha, int beta);
+        void insert(uint64_t hash, const Board &state, int score, int alpha, int beta, int depth, uint64_t best_move);
 
         /**
          * @brief Retrieves an entry from the transposition table.
          * 
          * @param hash The unique hash value identifying the game state.
+         * @param state The game state, only used to detect key collisions in TT_VERIFY builds.
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
+         * @param depth The remaining search depth of the caller.
+         * @param best_move Set to the stored best move if the state is found at any depth, untouched otherwise.
          * @return int The score associated with the game state, or NOT_FOUND if the entry is not found.
          * 
          * This method retrieves the score of the game state identified by the
-         * given hash value. If the entry is not found, it returns NOT_FOUND.
+         * given hash value. Only entries searched at least as deep as requested
+         * are used for the score. Bound outside of the window is returned as stored,
+         * not clamped to the window. If the entry is not found, it returns NOT_FOUND.
          */
-        int get(uint64_t hash, int alpha, int beta);
+        int get(uint64_t hash, const Board &state, int alpha, int beta, int depth, uint64_t &best_move);
+
+        /**
+         * @brief Starts loading bucket of the game state into cache.
+         * 
+         * @param hash The unique hash value identifying the game state.
+         * 
+         * Used to hide memory latency of the probe which follows shortly after.
+         */
+        void prefetch(uint64_t hash) const;
+
+#ifdef TT_STATS
+        /// @brief Prints statistics of the last search and occupancy of the table.
+        void print_stats() const;
+#endif
 };
 
 /**
  * @brief Class representing a transposition table for storing game states.
  * 
- * This version is thread safe, but introduces some overhead.
+ * This version is thread safe and lock-free, one table is shared by all threads.
  * 
- * The Transposition_table class is used to store and retrieve game states
- * identified by their unique hash and alpha-beta values. It uses an internal
- * unordered map to maintain the mapping from hash values to their corresponding
- * entries.
+ * It uses the same bucket layout, entry format and replacement policy as
+ * TranspositionTable. Key and data words are separate atomics, key is stored
+ * XORed with the data, so entry torn by concurrent writes fails the key check
+ * and is treated as missing instead of returning mixed data.
+ * 
+ * Statistics are collected with relaxed atomic counters in TT_STATS builds.
+ * Snapshot files are shared with TranspositionTable, keys are converted
+ * when the file was written by the other table.
  */
 class TranspositionTableParallel {
     private:    
         /// @brief Structure representing an entry in the transposition table.
         struct Entry {
-            /// @brief The score associated with the game state.
-            int score;
-            /// @brief The type of the entry (exact, lower bound, upper bound).
-            int type;
+            /// @brief Hash of the stored game state XORed with the data word.
+            std::atomic<uint64_t> key;
+            /// @brief Packed score, depth, type, generation and best move of the entry.
+            std::atomic<uint64_t> data;
         };
 
-        /// @brief Number of used maps, reduces overhead.
-        static constexpr int map_count = 32;
+        /// @brief Number of entries sharing one cache line.
+        static constexpr int bucket_size = TranspositionTable::bucket_size;
 
-        /**
-         * @brief Vector of maps used as data structure.
-         * 
-         * Multiple maps are used to reduce the chance of two
-         * threads wanting to write into one map. This significantly
-         * reduces overhead.
-         */
-        std::vector<std::unordered_map<uint64_t, Entry>> maps;
+        /// @brief Group of entries which fits exactly into one cache line.
+        struct alignas(64) Bucket {
+            Entry entries[bucket_size];
+        };
 
-        /**
-         * @brief Vector of mutexes for maps.
-         * 
-         * One mutex for each map.
-         */
-        std::vector<std::mutex> mutexes;
+        /// @brief Number of allocated buckets.
+        uint64_t bucket_count;
+
+        /// @brief Memory holding the buckets.
+        HugePageBuffer memory;
+
+        /// @brief Header of the snapshot file, nullptr if the table is not backed by file.
+        TranspositionTable::SnapshotHeader *snapshot;
+
+        /// @brief The internal array of buckets, size is always power of two.
+        Bucket *buckets;
+
+        /// @brief Mask selecting bucket index from the hash.
+        uint64_t bucket_mask;
+
+        /// @brief Generation of the current search (6 bits), changes only between searches.
+        int generation;
+
+        /// @brief Stores entry into the always-replace tier of the bucket, returns the used slot.
+        Entry *store_always(Bucket &bucket, uint64_t key, uint64_t data);
+
+#ifdef TT_STATS
+        /// @brief Usage statistics of the last search, see TranspositionTable::Stats.
+        struct Stats {
+            std::atomic<uint64_t> probes;
+            std::atomic<uint64_t> hits;
+            std::atomic<uint64_t> cutoffs;
+            std::atomic<uint64_t> stores;
+            std::atomic<uint64_t> overwrites;
+            std::atomic<uint64_t> collisions;
+        } stats;
+#endif
+
+#ifdef TT_VERIFY
+        /// @brief Board stored with the entry, torn boards can be reported as false collisions. Boards are not saved to snapshot file, restored entries have empty board and are not verified.
+        struct StoredBoard {
+            std::atomic<uint64_t> white;
+            std::atomic<uint64_t> black;
+        };
+
+        /// @brief Boards of all entries, indexed the same way as entries.
+        std::vector<StoredBoard> boards;
+
+        /// @brief Returns index of the entry into array of boards.
+        uint64_t entry_index(const Entry *entry) const;
+#endif
 
     public:
         /// @brief Constant representing that entry was not found.
         static constexpr int NOT_FOUND = 1111;
 
-        TranspositionTableParallel();
+        /**
+         * @brief Allocates the table.
+         * 
+         * @param size_mb Memory budget in megabytes, rounded down to the nearest power of two.
+         * @param snapshot_file File the table is saved to and restored from, nullptr to keep it only in memory.
+         */
+        explicit TranspositionTableParallel(int size_mb, const char *snapshot_file = nullptr);
 
         /// @brief Removes all entries stored in the transposition table.
         void clear();
 
+        /**
+         * @brief Starts new search generation.
+         * 
+         * Entries of previous searches stay usable, but are replaced first.
+         * Must not be called while search threads are running.
+         */
+        void new_search();
+
         /**
          * @brief Inserts a new entry into the transposition table.
          * 
          * @param hash The unique hash value identifying the game state.
+         * @param state The game state, only used to detect key collisions in TT_VERIFY builds.
          * @param score The score associated with the game state.
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
+         * @param depth The remaining search depth the score was computed with.
+         * @param best_move The best move found (or move which caused cutoff), 0 if none.
          * 
          * Score, alpha and beta values are used to determine entry type.
          */
-        void insert(uint64_t hash, int score, int alpha, int beta);
+        void insert(uint64_t hash, const Board &state, int score, int alpha, int beta, int depth, uint64_t best_move);
 
         /**
          * @brief Retrieves an entry from the transposition table.
          * 
          * @param hash The unique hash value identifying the game state.
+         * @param state The game state, only used to detect key collisions in TT_VERIFY builds.
          * @param alpha The alpha value for alpha-beta pruning.
          * @param beta The beta value for alpha-beta pruning.
+         * @param depth The remaining search depth of the caller.
+         * @param best_move Set to the stored best move if the state is found at any depth, untouched otherwise.
          * @return int The score associated with the game state, or NOT_FOUND if the entry is not found.
          * 
          * This method retrieves the score of the game state identified by the
-         * given hash value. If the entry is not found, it returns NOT_FOUND.
+         * given hash value. Only entries searched at least as deep as requested
+         * are used for the score. Bound outside of the window is returned as stored,
+         * not clamped to the window. If the entry is not found, it returns NOT_FOUND.
+         */
+        int get(uint64_t hash, const Board &state, int alpha, int beta, int depth, uint64_t &best_move);
+
+        /**
+         * @brief Starts loading bucket of the game state into cache.
+         * 
+         * @param hash The unique hash value identifying the game state.
+         * 
+         * Used to hide memory latency of the probe which follows shortly after.
          */
-        int get(uint64_t hash, int alpha, int beta);
+        void prefetch(uint64_t hash) const;
+
+#ifdef TT_STATS
+        /// @brief Prints statistics of the last search and occupancy of the table.
+        void print_stats() const;
+#endif
 };
 
 #endif
@@ -0,0 +1,98 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#ifndef HUGE_PAGE_BUFFER_H
+#define HUGE_PAGE_BUFFER_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Class owning one large, zero-initialized block of memory.
+ * 
+ * On linux the block is mapped with mmap, aligned to 2 MB and advised
+ * to be backed by transparent huge pages, which reduces TLB misses on
+ * random access. On other platforms it falls back to aligned operator new.
+ * 
+ * The block can be also backed by a file, so its content survives restarts.
+ * On linux the file is mapped shared and read-write, elsewhere it is read
+ * at construction and written back at destruction.
+ * 
+ * Only one process can use the file at a time. On linux the mapping holds
+ * exclusive lock on the file, other processes which try to use it get
+ * anonymous memory instead, so they never resize or write the file under
+ * the mapping of the owner.
+ */
+class HugePageBuffer {
+    private:
+        /// @brief Size of one huge page.
+        static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        /// @brief Pointer to the start of the usable block.
+        void *ptr;
+
+        /// @brief Requested size of the block in bytes.
+        size_t buffer_size;
+
+        /// @brief Size of the mapping, 0 if block was not allocated with mmap.
+        size_t mapped_size;
+
+        /// @brief Locked descriptor of the mapped file, -1 if no file is mapped.
+        int file_descriptor;
+
+        /// @brief Backing file which is written at destruction, empty if not needed.
+        std::string write_back_path;
+
+        /// @brief True if the block was filled from existing file of the same size.
+        bool file_restored;
+
+        /// @brief Allocates anonymous zeroed block.
+        void allocate(size_t size);
+
+        /// @brief Locks and maps the file shared, returns false if it is not possible or another process holds the lock.
+        bool map_file(size_t size, const char *path);
+
+    public:
+        /**
+         * @brief Allocates the block.
+         * 
+         * @param size Size of the block in bytes.
+         * @param file_path File backing the block, nullptr for anonymous memory.
+         * 
+         * Backing file of different size is truncated and zeroed. If the file
+         * cannot be used or is locked by another process, anonymous memory
+         * is allocated instead.
+         */
+        explicit HugePageBuffer(size_t size, const char *file_path = nullptr);
+
+        /// @brief Returns the block back to the system.
+        ~HugePageBuffer();
+
+        HugePageBuffer(const HugePageBuffer&) = delete;
+        HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+        /// @brief Pointer to the block, aligned at least to cache line.
+        void *data() const;
+
+        /// @brief Size of the block in bytes.
+        size_t size() const;
+
+        /// @brief Returns true if the block holds content of previously saved file.
+        bool restored() const;
+};
+
+#endif
@@ -49,6 +49,24 @@ class Parser {
         /// @brief Tries to parse engine search order.
         bool parse_order(int argc, char **argv, int &i);
 
+        /// @brief Tries to parse transposition table size.
+        bool parse_hash_size(int argc, char **argv, int &i);
+
+        /// @brief Tries to parse time limit.
+        bool parse_time_limit(int argc, char **argv, int &i);
+
+        /// @brief Tries to parse aspiration window policy.
+        bool parse_aspiration(int argc, char **argv, int &i);
+
+        /// @brief Tries to parse number of empties solved exactly.
+        bool parse_endgame(int argc, char **argv, int &i);
+
+        /// @brief Tries to parse late move reduction policy.
+        bool parse_lmr(int argc, char **argv, int &i);
+
+        /// @brief Tries to parse transposition table snapshot file.
+        bool parse_hash_file(int argc, char **argv, int &i);
+
     public:
         Parser();
 
@@ -16,6 +16,7 @@
 */
 
 #include "app/app.h"
+#include <vector>
 
 App::App(Mode mode, UI *ui, Engine *engine) : mode(mode), ui(ui), engine(engine) {}
 
@@ -23,6 +24,7 @@ void App::run() {
     if (mode == Mode::PLAY) {run_play();}
     else if (mode == Mode::BOT_VS_BOT) run_bot_vs_bot();
     else if (mode == Mode::BENCHMARK) run_benchmark();
+    else if (mode == Mode::SOLVE) run_solve();
 }
 
 void App::run_play() {
@@ -31,6 +33,8 @@ void App::run_play() {
     
     bool at_turn = false;
     bool last_moved = true;
+    // expected reply the engine searches during player's turn, 0 if it does not
+    uint64_t ponder_move = 0;
 
     ui->display_game(last_board, current_board, at_turn);
     while (true) {
@@ -57,15 +61,36 @@ void App::run_play() {
                 ui->display_game(last_board, current_board, at_turn);
                 ui->display_message("INVALID");
             }
+            if (ponder_move != 0 && move != ponder_move) {
+                engine->ponder_miss();
+                ponder_move = 0;
+            }
             last_board = current_board;
             current_board.play_move(at_turn, move);
         }
         else {
             uint64_t move = 0;
             ui->display_message("Thinking...");
-            move = engine->search(current_board, at_turn);
+            if (ponder_move != 0) {
+                move = engine->ponder_hit();
+                ponder_move = 0;
+            }
+            else {
+                move = engine->search(current_board, at_turn);
+            }
             last_board = current_board;
             current_board.play_move(at_turn, move);
+
+            // second move of principal variation is the expected reply, the engine
+            // searches the state after it while the player thinks
+            std::vector<uint64_t> pv = engine->get_pv();
+            if (pv.size() > 1 && pv[0] == move && (pv[1] & current_board.find_moves(!at_turn))) {
+                Board expected = current_board;
+                expected.play_move(!at_turn, pv[1]);
+                if (expected.find_moves(at_turn) != 0 && engine->ponder(expected, at_turn)) {
+                    ponder_move = pv[1];
+                }
+            }
         }
         at_turn = !at_turn;
     }
@@ -97,4 +122,13 @@ void App::run_benchmark() {
     uint64_t move = 0;
     move = engine->search(init_board, false);
     ui->display_board(init_board, move);
+    engine->print_stats();
+}
+
+void App::run_solve() {
+    Board init_board = Board::States::ENDGAME;
+    uint64_t move = 0;
+    move = engine->search(init_board, false);
+    ui->display_board(init_board, move);
+    engine->print_stats();
 }
@@ -104,25 +104,19 @@ ALWAYS_INLINE int Board::rate_board() const {
         score += static_cast<int>(int_result[i]);
     }
     
-    int moves_delta = std::popcount(find_moves(true)) - std::popcount(find_moves(false));
+    int moves_delta = std::popcount(find_moves<true>()) - std::popcount(find_moves<false>());
     score += 10 * moves_delta;
     return score;
 }
 
-ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
+template <bool COLOR>
+ALWAYS_INLINE uint64_t Board::find_moves() const {
     uint64_t valid_moves = 0;
     // create new bitmap of empty spaces from our two bitmaps so we do not have to check both for empty spaces
     uint64_t free_spaces = ~(white_bitmap | black_bitmap);
-    // load table of player at turn and opponent player
-    uint64_t playing, opponent;
-    if (color) {
-        playing = white_bitmap;
-        opponent = black_bitmap;
-    }
-    else {
-        playing = black_bitmap;
-        opponent = white_bitmap;
-    }
+    // load table of player at turn and opponent player, known at compile time
+    uint64_t playing = COLOR ? white_bitmap : black_bitmap;
+    uint64_t opponent = COLOR ? black_bitmap : white_bitmap;
 
     // same algorithm as non-vectorized code, uses SIMD
     // to proccess all directions at once
@@ -183,17 +177,11 @@ ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
     return valid_moves;
 }
 
-ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
-    uint64_t playing, opponent;
-    if (color) {
-        playing = white_bitmap;
-        opponent = black_bitmap;
-    }
-    else {
-        playing = black_bitmap;
-        opponent = white_bitmap;
-    }
+ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
+    return color ? find_moves<true>() : find_moves<false>();
+}
 
+ALWAYS_INLINE uint64_t Board::flips(uint64_t playing, uint64_t opponent, uint64_t move) {
     // 9 -> top left / bottom right
     // 8 -> up / down
     // 7 -> top right / bottom left
@@ -238,24 +226,39 @@ ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
     friendly_right_check = _mm256_cmpeq_epi64(friendly_right_check, compare_vec);
     __m256i capture_left_vec = _mm256_andnot_si256(friendly_left_check, left_shift_vec);
     __m256i capture_right_vec = _mm256_andnot_si256(friendly_right_check, right_shift_vec);
-    opponent_vec = _mm256_xor_si256(opponent_vec, capture_left_vec);
-    opponent_vec = _mm256_xor_si256(opponent_vec, capture_right_vec);
-    playing_vec = _mm256_or_si256(playing_vec, capture_left_vec);
-    playing_vec = _mm256_or_si256(playing_vec, capture_right_vec);
-
-    uint64_t playing_data[4];
-    uint64_t opponent_data[4];
-    _mm256_storeu_si256((__m256i *) playing_data, playing_vec);
-    _mm256_storeu_si256((__m256i *) opponent_data, opponent_vec);
-    playing = playing_data[0] | playing_data[1] | playing_data[2] | playing_data[3] | move;
-    opponent = opponent_data[0] & opponent_data[1] & opponent_data[2] & opponent_data[3];
+    __m256i capture_vec = _mm256_or_si256(capture_left_vec, capture_right_vec);
+
+    uint64_t capture_data[4];
+    _mm256_storeu_si256((__m256i *) capture_data, capture_vec);
+    return capture_data[0] | capture_data[1] | capture_data[2] | capture_data[3];
+}
+
+template <bool COLOR>
+ALWAYS_INLINE void Board::play_move(uint64_t move) {
+    uint64_t playing = COLOR ? white_bitmap : black_bitmap;
+    uint64_t opponent = COLOR ? black_bitmap : white_bitmap;
+
+    uint64_t capture = flips(playing, opponent, move);
+    playing |= move | capture;
+    opponent ^= capture;
 
+    update_hash<COLOR>(move, capture);
+
+    white_bitmap = COLOR ? playing : opponent;
+    black_bitmap = COLOR ? opponent : playing;
+}
+
+ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
     if (color) {
-        white_bitmap = playing;
-        black_bitmap = opponent;
+        play_move<true>(move);
     }
     else {
-        white_bitmap = opponent;
-        black_bitmap = playing;
+        play_move<false>(move);
     }
 }
+
+// kernels are defined in this file only, engines link to these
+template uint64_t Board::find_moves<true>() const;
+template uint64_t Board::find_moves<false>() const;
+template void Board::play_move<true>(uint64_t move);
+template void Board::play_move<false>(uint64_t move);
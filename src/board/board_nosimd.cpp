@@ -47,26 +47,20 @@ ALWAYS_INLINE int Board::rate_board() const {
         b &= b - 1;
     }
 
-    int moves_delta = std::popcount(find_moves(true)) - std::popcount(find_moves(false));
+    int moves_delta = std::popcount(find_moves<true>()) - std::popcount(find_moves<false>());
     score += 10 * moves_delta;
 
     return score;
 }
 
-ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
+template <bool COLOR>
+ALWAYS_INLINE uint64_t Board::find_moves() const {
     uint64_t valid_moves = 0;
     // create new bitmap of empty spaces from our two bitmaps so we do not have to check both for empty spaces
     uint64_t free_spaces = ~(white_bitmap | black_bitmap);
-    // load table of player at turn and opponent player
-    uint64_t playing, opponent;
-    if (color) {
-        playing = white_bitmap;
-        opponent = black_bitmap;
-    }
-    else {
-        playing = black_bitmap;
-        opponent = white_bitmap;
-    }
+    // load table of player at turn and opponent player, known at compile time
+    uint64_t playing = COLOR ? white_bitmap : black_bitmap;
+    uint64_t opponent = COLOR ? black_bitmap : white_bitmap;
 
     uint64_t dir_copy;
     uint64_t opponent_adjusted = opponent & Masks::RIGHT_COL_MASK & Masks::LEFT_COL_MASK;
@@ -109,17 +103,12 @@ ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
     return valid_moves;
 }
 
-ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
-    uint64_t playing, opponent;
-    if (color) {
-        playing = white_bitmap;
-        opponent = black_bitmap;
-    }
-    else {
-        playing = black_bitmap;
-        opponent = white_bitmap;
-    }
+ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
+    return color ? find_moves<true>() : find_moves<false>();
+}
 
+ALWAYS_INLINE uint64_t Board::flips(uint64_t playing, uint64_t opponent, uint64_t move) {
+    uint64_t capture = 0;
     auto check_dir = [&](uint64_t col_mask, int shift) {
         bool found = false;
         uint64_t playing_adjusted = playing & col_mask;
@@ -132,12 +121,10 @@ ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
             offset = (shift < 0) ? (offset << (-shift)) : (offset >> shift);
         }
         if (found && (playing_adjusted & offset)) {
-            playing |= line;
-            opponent ^= line;
+            capture |= line;
         }
     };
 
-    playing |= move; // capture the space
     check_dir(Masks::LEFT_COL_MASK ,-9); // top left
     check_dir(Masks::NO_COL_MASK   ,-8); // top
     check_dir(Masks::RIGHT_COL_MASK,-7); // top right
@@ -146,13 +133,35 @@ ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
     check_dir(Masks::LEFT_COL_MASK , 7); // bottom left
     check_dir(Masks::NO_COL_MASK   , 8); // bottom
     check_dir(Masks::RIGHT_COL_MASK, 9); // bottom right*/
+    return capture;
+}
+
+template <bool COLOR>
+ALWAYS_INLINE void Board::play_move(uint64_t move) {
+    uint64_t playing = COLOR ? white_bitmap : black_bitmap;
+    uint64_t opponent = COLOR ? black_bitmap : white_bitmap;
+
+    uint64_t capture = flips(playing, opponent, move);
+    playing |= move | capture; // capture the space
+    opponent ^= capture;
 
+    update_hash<COLOR>(move, capture);
+
+    white_bitmap = COLOR ? playing : opponent;
+    black_bitmap = COLOR ? opponent : playing;
+}
+
+ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
     if (color) {
-        white_bitmap = playing;
-        black_bitmap = opponent;
+        play_move<true>(move);
     }
     else {
-        white_bitmap = opponent;
-        black_bitmap = playing;
+        play_move<false>(move);
     }
 }
+
+// kernels are defined in this file only, engines link to these
+template uint64_t Board::find_moves<true>() const;
+template uint64_t Board::find_moves<false>() const;
+template void Board::play_move<true>(uint64_t move);
+template void Board::play_move<false>(uint64_t move);
@@ -138,17 +138,12 @@ ALWAYS_INLINE int Board::rate_board() const {
     return score;
 }
 
-ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
+template <bool COLOR>
+ALWAYS_INLINE uint64_t Board::find_moves() const {
     uint64_t free_spaces = ~(white_bitmap | black_bitmap);
 
-    uint64_t playing, opponent;
-    if (color) {
-        playing = white_bitmap;
-        opponent = black_bitmap;
-    } else {
-        playing = black_bitmap;
-        opponent = white_bitmap;
-    }
+    uint64_t playing = COLOR ? white_bitmap : black_bitmap;
+    uint64_t opponent = COLOR ? black_bitmap : white_bitmap;
 
     const size_t vl = __riscv_vsetvl_e64m1(4);
     vuint64m1_t sv = __riscv_vle64_v_u64m1(shift_vals_data, vl);
@@ -157,18 +152,11 @@ ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
     return find_moves_core(playing, opponent, free_spaces, sv, cm, vl);
 }
 
-ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
-    uint64_t playing;
-    uint64_t opponent;
-    if (color) {
-        playing = white_bitmap;
-        opponent = black_bitmap;
-    }
-    else {
-        playing = black_bitmap;
-        opponent = white_bitmap;
-    }
+ALWAYS_INLINE uint64_t Board::find_moves(bool color) const {
+    return color ? find_moves<true>() : find_moves<false>();
+}
 
+ALWAYS_INLINE uint64_t Board::flips(uint64_t playing, uint64_t opponent, uint64_t move) {
     const size_t vl = __riscv_vsetvl_e64m1(4);
     vuint64m1_t shift_vals_vec = __riscv_vle64_v_u64m1(shift_vals_data, vl);
     vuint64m1_t col_mask_vec = __riscv_vle64_v_u64m1(col_mask_data, vl);
@@ -217,18 +205,36 @@ ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
     vuint64m1_t capture_all = __riscv_vor_vv_u64m1(capture_left, capture_right, vl);
     vuint64m1_t zero_scalar = __riscv_vmv_v_x_u64m1(0, 1);
     vuint64m1_t reduced = __riscv_vredor_vs_u64m1_u64m1(capture_all, zero_scalar, vl);
-    uint64_t capture = __riscv_vmv_x_s_u64m1_u64(reduced);
+    return __riscv_vmv_x_s_u64m1_u64(reduced);
+}
+
+template <bool COLOR>
+ALWAYS_INLINE void Board::play_move(uint64_t move) {
+    uint64_t playing = COLOR ? white_bitmap : black_bitmap;
+    uint64_t opponent = COLOR ? black_bitmap : white_bitmap;
 
+    uint64_t capture = flips(playing, opponent, move);
     playing |= move;
     playing |= capture;
     opponent ^= capture;
 
+    update_hash<COLOR>(move, capture);
+
+    white_bitmap = COLOR ? playing : opponent;
+    black_bitmap = COLOR ? opponent : playing;
+}
+
+ALWAYS_INLINE void Board::play_move(bool color, uint64_t move) {
     if (color) {
-        white_bitmap = playing;
-        black_bitmap = opponent;
+        play_move<true>(move);
     }
     else {
-        white_bitmap = opponent;
-        black_bitmap = playing;
+        play_move<false>(move);
     }
-}
\ No newline at end of file
+}
+
+// kernels are defined in this file only, engines link to these
+template uint64_t Board::find_moves<true>() const;
+template uint64_t Board::find_moves<false>() const;
+template void Board::play_move<true>(uint64_t move);
+template void Board::play_move<false>(uint64_t move);
\ No newline at end of file
@@ -27,9 +27,77 @@
 #include "board/board.h"
 #include <bit>
 
-Board::Board() : white_bitmap(0), black_bitmap(0) {}
+// zobrist keys are generated at compile time with splitmix64 generator
+struct ZobristKeys {
+    /// @brief Key of white piece at each bit position.
+    uint64_t white[64];
+    /// @brief Key of black piece at each bit position.
+    uint64_t black[64];
+    /// @brief Key of white player at turn.
+    uint64_t side;
+    /**
+     * @brief Combined keys of flipped pieces for every byte of the bitmap.
+     * 
+     * Flipping piece toggles both its white and black key. Using byte lookup
+     * instead of iterating over flipped pieces keeps play_move branch-free.
+     */
+    uint64_t flip[8][256];
 
-Board::Board(const uint64_t white_bitmap, const uint64_t black_bitmap) : white_bitmap(white_bitmap), black_bitmap(black_bitmap) {}
+    constexpr ZobristKeys() : white(), black(), side(0), flip() {
+        uint64_t state = 0x9e3779b97f4a7c15;
+        auto next = [&state]() {
+            state += 0x9e3779b97f4a7c15;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        };
+        for (int i = 0; i < 64; ++i) {
+            white[i] = next();
+            black[i] = next();
+        }
+        side = next();
+        for (int byte = 0; byte < 8; ++byte) {
+            for (int val = 0; val < 256; ++val) {
+                for (int bit = 0; bit < 8; ++bit) {
+                    if (val & (1 << bit)) {
+                        flip[byte][val] ^= white[byte*8 + bit] ^ black[byte*8 + bit];
+                    }
+                }
+            }
+        }
+    }
+};
+
+static constexpr ZobristKeys zobrist;
+
+Board::Board() : white_bitmap(0), black_bitmap(0), hash_key(0) {}
+
+Board::Board(const uint64_t white_bitmap, const uint64_t black_bitmap) :
+    white_bitmap(white_bitmap),
+    black_bitmap(black_bitmap),
+    hash_key(compute_hash(white_bitmap, black_bitmap))
+{}
+
+uint64_t Board::compute_hash(uint64_t white_bitmap, uint64_t black_bitmap) {
+    uint64_t key = 0;
+    for (; white_bitmap; white_bitmap &= white_bitmap - 1) {
+        key ^= zobrist.white[std::countr_zero(white_bitmap)];
+    }
+    for (; black_bitmap; black_bitmap &= black_bitmap - 1) {
+        key ^= zobrist.black[std::countr_zero(black_bitmap)];
+    }
+    return key;
+}
+
+template <bool COLOR>
+ALWAYS_INLINE void Board::update_hash(uint64_t move, uint64_t flipped) {
+    int move_pos = std::countr_zero(move);
+    hash_key ^= COLOR ? zobrist.white[move_pos] : zobrist.black[move_pos];
+    for (int byte = 0; byte < 8; ++byte) {
+        hash_key ^= zobrist.flip[byte][(flipped >> (byte*8)) & 0xff];
+    }
+}
 
 ALWAYS_INLINE uint64_t Board::white() const {
     return white_bitmap;
@@ -47,25 +115,21 @@ ALWAYS_INLINE int Board::count_black() const {
     return std::popcount(black_bitmap);
 }
 
+template <bool COLOR>
 ALWAYS_INLINE uint64_t Board::hash() const {
-    // Murmur hash of white
-    uint64_t w = white_bitmap;
-    w ^= w >> 33;
-    w *= 0xff51afd7ed558ccd;
-    w ^= w >> 33;
-    w *= 0xc4ceb9fe1a85ec53;
-    w ^= w >> 33;
-    // Murmur hash of black
-    uint64_t b = black_bitmap;
-    b ^= b >> 33;
-    b *= 0xff51afd7ed558ccd;
-    b ^= b >> 33;
-    b *= 0xc4ceb9fe1a85ec53;
-    b ^= b >> 33;
-    // Combine white and black hashes
-    return w ^ b;
+    return COLOR ? hash_key ^ zobrist.side : hash_key;
+}
+
+ALWAYS_INLINE uint64_t Board::hash(bool color) const {
+    return color ? hash<true>() : hash<false>();
 }
 
+// play_move of every simd variant updates the hash with these
+template void Board::update_hash<true>(uint64_t move, uint64_t flipped);
+template void Board::update_hash<false>(uint64_t move, uint64_t flipped);
+template uint64_t Board::hash<true>() const;
+template uint64_t Board::hash<false>() const;
+
 const Board Board::States::INITIAL = Board(
     // or operations just for readability
     // static cast so the number is not simple integer - shifting would go out of range
@@ -135,4 +199,28 @@ const Board Board::States::BENCHMARK = Board(
     static_cast<uint64_t>(0b11101000) << 16 |
     static_cast<uint64_t>(0b00000000) << 8 |
     static_cast<uint64_t>(0b00000000)
-);
+);
+
+const Board Board::States::ENDGAME = Board(
+    // engine game position with 20 empty squares and black at turn, solved in seconds
+    // or operations just for readability
+    // static cast so the number is not simple integer - shifting would go out of range
+    // WHITE
+    static_cast<uint64_t>(0b00000000) << 56 |
+    static_cast<uint64_t>(0b00111100) << 48 |
+    static_cast<uint64_t>(0b01101100) << 40 |
+    static_cast<uint64_t>(0b00110100) << 32 |
+    static_cast<uint64_t>(0b00010100) << 24 |
+    static_cast<uint64_t>(0b00001010) << 16 |
+    static_cast<uint64_t>(0b00000000) << 8 |
+    static_cast<uint64_t>(0b00000000),
+    // BLACK
+    static_cast<uint64_t>(0b00011110) << 56 |
+    static_cast<uint64_t>(0b00000001) << 48 |
+    static_cast<uint64_t>(0b00010011) << 40 |
+    static_cast<uint64_t>(0b00001011) << 32 |
+    static_cast<uint64_t>(0b01101011) << 24 |
+    static_cast<uint64_t>(0b00110101) << 16 |
+    static_cast<uint64_t>(0b00111101) << 8 |
+    static_cast<uint64_t>(0b00011110)
+);
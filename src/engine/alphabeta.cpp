@@ -19,13 +19,14 @@
 #include <iostream>
 
 // initialize stats counters and select move order
-Alphabeta::Alphabeta(Engine::Settings settings) : total_heuristic_count(0), total_state_count(0), move_order(settings.order) {
+Alphabeta::Alphabeta(Engine::Settings settings) : total_heuristic_count(0), total_state_count(0), move_order(settings.order), transposition_table(settings.transposition_enable ? settings.hash_size : 0, settings.transposition_enable ? settings.hash_file : nullptr) {
     this->settings = settings;
 }
 
 uint64_t Alphabeta::search(Board state, bool color) {
-    // transposition table must be empty before calculation of best move, otherwise results would be affected
-    transposition_table.clear();
+    // transposition table is kept between moves, results of older searches are only marked as stale
+    transposition_table.new_search();
+    move_history.new_search();
     
     // reset stats counters
     last_heuristic_count = 0;
@@ -34,61 +35,81 @@ uint64_t Alphabeta::search(Board state, bool color) {
     uint64_t best_move = 0;
     uint64_t possible_moves = state.find_moves(color);
 
-    int alpha = -1000;
-    int beta = 1000;
     int best_eval = 0;
-    int eval;
-    Board next;
-    
-    if (color == true && possible_moves != 0) {
-        best_eval = -1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(color, move);
-                eval = alphabeta(next, settings.search_depth-1, !color, alpha, beta, false);
-                if (eval > best_eval) {
-                    best_move = move;
-                    best_eval = eval;
-                }
-                alpha = std::max(eval, alpha);
-            }
-        }
+    pv.new_root();
+    if (possible_moves != 0) {
+        // kernels search in negamax form, the score is turned around for black
+        best_eval = color ? search_root<true>(state, best_move) : -search_root<false>(state, best_move);
     }
-    else if (color == false && possible_moves != 0) {
-        best_eval = 1000;
-        for (uint64_t move : move_order) {
-            if ((possible_moves & move) != 0) {
-                next = state;
-                next.play_move(color, move);
-                eval = alphabeta(next, settings.search_depth-1, !color, alpha, beta, false);
-                if (eval < best_eval) {
-                    best_move = move;
-                    best_eval = eval;
-                }
-                beta = std::min(eval, beta);
-            }
-        }
+
+    last_pv = pv.line();
+    if (settings.transposition_enable) {
+        PV_table::extend(last_pv, state, color, settings.search_depth, transposition_table);
     }
 
     std::cout << "Went through " << last_state_count     << " states.\n";
     std::cout << "Analyzed     " << last_heuristic_count << " states.\n";
+    std::cout << "PV           " << PV_table::to_string(last_pv) << '\n';
     std::cout << best_eval << '\n';
     total_heuristic_count += last_heuristic_count;
     total_state_count += last_state_count;
     return best_move;
 }
 
-int Alphabeta::alphabeta(Board state, int depth, bool cur_color, int alpha, int beta, bool end_board) {
+template <bool COLOR>
+int Alphabeta::search_root(const Board &state, uint64_t &best_move) {
+    uint64_t possible_moves = state.find_moves<COLOR>();
+
+    int alpha = -1000;
+    int beta = 1000;
+    int best_eval = -1000;
+    int eval;
+    Board next;
+    for (uint64_t move : move_order) {
+        if (possible_moves & move) {
+            next = state;
+            next.play_move<COLOR>(move);
+            eval = -alphabeta<!COLOR>(next, settings.search_depth-1, 1, -beta, -alpha, false);
+            if (eval > best_eval) {
+                best_move = move;
+                best_eval = eval;
+            }
+            if (eval > alpha && eval < beta) {
+                pv.update(0, move);
+            }
+            alpha = std::max(eval, alpha);
+        }
+    }
+    return best_eval;
+}
+
+std::vector<uint64_t> Alphabeta::get_pv() const {
+    return last_pv;
+}
+
+void Alphabeta::print_stats() const {
+#ifdef TT_STATS
+    if (settings.transposition_enable) {
+        transposition_table.print_stats();
+    }
+#endif
+}
+
+template <bool COLOR>
+int Alphabeta::alphabeta(const Board &state, int depth, int ply, int alpha, int beta, bool end_board) {
     int init_alpha = alpha;
     int init_beta = beta;
     uint64_t hash = 0;
+    uint64_t hash_move = 0;
     last_state_count++;
+
+    // line below the node is built again, nodes cut off early leave it empty
+    pv.clear(ply);
     
     // reach max depth
     if (depth == 0) {
         last_heuristic_count++;
-        return state.rate_board();
+        return relative<COLOR>(state.rate_board());
     }
     
     // check if state was already calculated
@@ -96,15 +117,15 @@ int Alphabeta::alphabeta(Board state, int depth, bool cur_color, int alpha, int
     // too large at lower levels, it is then faster
     // to just calculate the score again
     if (settings.transposition_enable && depth > 2) {
-        hash = state.hash();
-        int score = transposition_table.get(hash, alpha, beta);
+        hash = state.hash<COLOR>();
+        int score = probe<COLOR>(transposition_table, hash, state, alpha, beta, depth, hash_move);
         if (score != TranspositionTable::NOT_FOUND) {
             return score;
         }
     }
     
     // if there are no possible moves
-    uint64_t possible_moves = state.find_moves(cur_color);
+    uint64_t possible_moves = state.find_moves<COLOR>();
     int eval;
     if (possible_moves == 0) {
         if (end_board) {
@@ -113,49 +134,49 @@ int Alphabeta::alphabeta(Board state, int depth, bool cur_color, int alpha, int
             if (count_white > count_black) {eval = 999;}
             else if (count_white < count_black) {eval = -999;}
             else {eval = 0;}
+            eval = relative<COLOR>(eval);
         }
         else {
-            eval = alphabeta(state, depth, !cur_color, alpha, beta, true);
+            eval = -alphabeta<!COLOR>(state, depth, ply, -beta, -alpha, true);
         }
         return eval;
     }
 
-    int best_eval;
-    Board next;
-    if (cur_color == true) {
-        best_eval = -1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(cur_color, move);
-                eval = alphabeta(next, depth-1, !cur_color, alpha, beta, false);
-                best_eval = std::max(eval, best_eval);
-                alpha = std::max(eval, alpha);
-                if (beta <= alpha) {
-                    break;
-                }
-            }
-        }
+    // move stored in transposition table is searched first, then killers and history
+    uint64_t moves[64];
+    int move_count;
+    if (depth >= HISTORY_MIN_DEPTH) {
+        move_count = move_history.sort(move_order, state, COLOR, possible_moves, hash_move, moves);
     }
     else {
-        best_eval = 1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(cur_color, move);
-                eval = alphabeta(next, depth-1, !cur_color, alpha, beta, false);
-                best_eval = std::min(eval, best_eval);
-                beta = std::min(eval, beta);
-                if (beta <= alpha) {
-                    break;
-                }
-            }
+        move_count = move_order.sort(possible_moves, hash_move, moves);
+    }
+
+    int best_eval = -1000;
+    uint64_t best_move = 0;
+    Board next;
+    for (int i = 0; i < move_count; ++i) {
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        eval = -alphabeta<!COLOR>(next, depth-1, ply+1, -beta, -alpha, false);
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
+        }
+        if (eval > alpha && eval < beta) {
+            pv.update(ply, move);
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            move_history.update(state, COLOR, move, depth);
+            break;
         }
     }
     
     // save the score for future
     if (settings.transposition_enable && depth > 2) {
-        transposition_table.insert(hash, best_eval, init_alpha, init_beta);
+        store<COLOR>(transposition_table, hash, state, best_eval, init_alpha, init_beta, depth, best_move);
     }
     
     return best_eval;
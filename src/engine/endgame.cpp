@@ -0,0 +1,397 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "engine/endgame.h"
+#include <bit>
+#include <algorithm>
+
+// lower than any final disc differential, marks node without a move
+static constexpr int NO_MOVE = -65;
+
+Endgame::Endgame(TranspositionTable *transposition_table, const std::atomic<bool> *abort) : transposition_table(transposition_table), abort(abort), state_count(0), next_clock_check(0), timed_out(false) {}
+
+unsigned long long int Endgame::get_state_count() const {
+    return state_count;
+}
+
+bool Endgame::aborted() const {
+    return timed_out || (abort != nullptr && abort->load(std::memory_order_relaxed));
+}
+
+inline bool Endgame::stopped() {
+    // reading the clock costs more than a node near the leaves, it is done only once in a while
+    if (state_count >= next_clock_check) {
+        next_clock_check = state_count + CLOCK_INTERVAL;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            timed_out = true;
+        }
+    }
+    return aborted();
+}
+
+uint64_t Endgame::stored_move(const Board &state, bool color) {
+    uint64_t move = 0;
+    if (transposition_table != nullptr) {
+        // no entry is this deep, the probe only fetches the stored move
+        transposition_table->get(state.hash(color) ^ ENDGAME_KEY, state, -64, 64, 64, move);
+    }
+    return move;
+}
+
+int Endgame::final_score(uint64_t player, uint64_t opponent) {
+    int player_count = std::popcount(player);
+    int opponent_count = std::popcount(opponent);
+    int empties = 64 - player_count - opponent_count;
+    if (player_count > opponent_count) return player_count - opponent_count + empties;
+    if (player_count < opponent_count) return player_count - opponent_count - empties;
+    return 0;
+}
+
+uint64_t Endgame::odd_quadrants(uint64_t empty) {
+    uint64_t odd = 0;
+    for (uint64_t quadrant : QUADRANTS) {
+        if (std::popcount(empty & quadrant) & 1) {
+            odd |= quadrant;
+        }
+    }
+    return odd & empty;
+}
+
+int Endgame::solve(const Board &state, bool color, int alpha, int beta, uint64_t &best_move, std::chrono::steady_clock::time_point deadline) {
+    state_count = 1;
+    this->deadline = deadline;
+    next_clock_check = CLOCK_INTERVAL;
+    timed_out = false;
+
+    // window is turned to the point of view of the player at turn
+    if (!color) {
+        std::swap(alpha, beta);
+        alpha = -alpha;
+        beta = -beta;
+    }
+
+    uint64_t possible_moves = state.find_moves(color);
+    uint64_t odd = odd_quadrants(~(state.white() | state.black()));
+
+    // same fastest-first order as inner nodes, without transposition table
+    uint64_t moves[64];
+    int keys[64];
+    int move_count = 0;
+    for (; possible_moves; possible_moves &= possible_moves - 1) {
+        uint64_t move = possible_moves & -possible_moves;
+        Board next = state;
+        next.play_move(color, move);
+        int key = 2 * std::popcount(next.find_moves(!color)) + ((move & odd) ? 0 : 1);
+        int i = move_count++;
+        for (; i > 0 && keys[i-1] > key; --i) {
+            moves[i] = moves[i-1];
+            keys[i] = keys[i-1];
+        }
+        moves[i] = move;
+        keys[i] = key;
+    }
+
+    int best_eval = NO_MOVE;
+    best_move = 0;
+    for (int i = 0; i < move_count; ++i) {
+        Board next = state;
+        next.play_move(color, moves[i]);
+
+        int eval;
+        if (i == 0) { // run first move with whole window
+            eval = -search(next, !color, -beta, -alpha, false);
+        }
+        else {
+            eval = -search(next, !color, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -search(next, !color, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = moves[i];
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            break;
+        }
+    }
+
+    return color ? best_eval : -best_eval;
+}
+
+int Endgame::search(const Board &state, bool color, int alpha, int beta, bool passed) {
+    uint64_t player = color ? state.white() : state.black();
+    uint64_t opponent = color ? state.black() : state.white();
+    int empties = 64 - std::popcount(player | opponent);
+
+    // last empties are searched without game states
+    if (empties <= PARITY_EMPTIES) {
+        switch (empties) {
+            case 0: return final_score(player, opponent);
+            case 1: return solve_1(player, opponent, ~(player | opponent));
+            case 2: return solve_2(player, opponent, alpha, beta, passed);
+            case 3: return solve_3(player, opponent, alpha, beta, passed);
+            case 4: return solve_4(player, opponent, alpha, beta, passed);
+            default: return search_parity(player, opponent, empties, alpha, beta, passed);
+        }
+    }
+
+    state_count++;
+    if (stopped()) {
+        return 0;
+    }
+
+    uint64_t possible_moves = state.find_moves(color);
+    if (possible_moves == 0) {
+        if (passed) {
+            return final_score(player, opponent);
+        }
+        return -search(state, !color, -beta, -alpha, true);
+    }
+
+    // check if state was already solved
+    int init_alpha = alpha;
+    int init_beta = beta;
+    uint64_t hash = 0;
+    uint64_t hash_move = 0;
+    if (transposition_table != nullptr) {
+        hash = state.hash(color) ^ ENDGAME_KEY;
+        int score = transposition_table->get(hash, state, alpha, beta, empties, hash_move);
+        if (score != TranspositionTable::NOT_FOUND) {
+            return score;
+        }
+    }
+
+    // fastest-first order, moves leaving the opponent fewer replies cut off sooner,
+    // odd parity breaks ties, move stored in transposition table is searched first
+    uint64_t odd = odd_quadrants(~(player | opponent));
+    uint64_t moves[64];
+    Board children[64];
+    int keys[64];
+    int move_count = 0;
+    for (; possible_moves; possible_moves &= possible_moves - 1) {
+        uint64_t move = possible_moves & -possible_moves;
+        Board next = state;
+        next.play_move(color, move);
+        int key = (move == hash_move) ? -1 : 2 * std::popcount(next.find_moves(!color)) + ((move & odd) ? 0 : 1);
+        int i = move_count++;
+        for (; i > 0 && keys[i-1] > key; --i) {
+            moves[i] = moves[i-1];
+            children[i] = children[i-1];
+            keys[i] = keys[i-1];
+        }
+        moves[i] = move;
+        children[i] = next;
+        keys[i] = key;
+    }
+
+    int best_eval = NO_MOVE;
+    uint64_t best_move = 0;
+    for (int i = 0; i < move_count; ++i) {
+        int eval;
+        if (i == 0) { // run first move with whole window
+            eval = -search(children[i], !color, -beta, -alpha, false);
+        }
+        else {
+            eval = -search(children[i], !color, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -search(children[i], !color, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = moves[i];
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            break;
+        }
+    }
+
+    // scores below aborted search are not valid
+    if (transposition_table != nullptr && !aborted()) {
+        transposition_table->insert(hash, state, best_eval, init_alpha, init_beta, empties, best_move);
+    }
+
+    return best_eval;
+}
+
+int Endgame::search_parity(uint64_t player, uint64_t opponent, int empties, int alpha, int beta, bool passed) {
+    state_count++;
+
+    // squares in regions with odd number of empties go first, there is a good chance
+    // of getting the last move in the region
+    uint64_t empty = ~(player | opponent);
+    uint64_t odd = odd_quadrants(empty);
+    const uint64_t groups[2] = {odd, empty & ~odd};
+
+    int best_eval = NO_MOVE;
+    for (uint64_t group : groups) {
+        for (; group; group &= group - 1) {
+            uint64_t move = group & -group;
+            uint64_t flipped = Board::flips(player, opponent, move);
+            if (flipped == 0) {
+                continue;
+            }
+            uint64_t next_player = opponent ^ flipped;
+            uint64_t next_opponent = player | flipped | move;
+
+            int eval;
+            if (empties == 5) {
+                eval = -solve_4(next_player, next_opponent, -beta, -alpha, false);
+            }
+            else {
+                eval = -search_parity(next_player, next_opponent, empties - 1, -beta, -alpha, false);
+            }
+
+            if (eval > best_eval) {
+                best_eval = eval;
+                if (eval >= beta) {
+                    return best_eval;
+                }
+                alpha = std::max(eval, alpha);
+            }
+        }
+    }
+
+    if (best_eval == NO_MOVE) {
+        if (passed) {
+            return final_score(player, opponent);
+        }
+        return -search_parity(opponent, player, empties, -beta, -alpha, true);
+    }
+    return best_eval;
+}
+
+int Endgame::solve_4(uint64_t player, uint64_t opponent, int alpha, int beta, bool passed) {
+    state_count++;
+
+    // odd parity squares first
+    uint64_t empty = ~(player | opponent);
+    uint64_t odd = odd_quadrants(empty);
+    uint64_t squares[4];
+    int count = 0;
+    for (uint64_t group = odd; group; group &= group - 1) squares[count++] = group & -group;
+    for (uint64_t group = empty & ~odd; group; group &= group - 1) squares[count++] = group & -group;
+
+    int best_eval = NO_MOVE;
+    for (uint64_t move : squares) {
+        uint64_t flipped = Board::flips(player, opponent, move);
+        if (flipped) {
+            int eval = -solve_3(opponent ^ flipped, player | flipped | move, -beta, -alpha, false);
+            if (eval > best_eval) {
+                best_eval = eval;
+                if (eval >= beta) {
+                    return best_eval;
+                }
+                alpha = std::max(eval, alpha);
+            }
+        }
+    }
+
+    if (best_eval == NO_MOVE) {
+        if (passed) {
+            return final_score(player, opponent);
+        }
+        return -solve_4(opponent, player, -beta, -alpha, true);
+    }
+    return best_eval;
+}
+
+int Endgame::solve_3(uint64_t player, uint64_t opponent, int alpha, int beta, bool passed) {
+    state_count++;
+
+    // odd parity squares first
+    uint64_t empty = ~(player | opponent);
+    uint64_t odd = odd_quadrants(empty);
+    uint64_t squares[3];
+    int count = 0;
+    for (uint64_t group = odd; group; group &= group - 1) squares[count++] = group & -group;
+    for (uint64_t group = empty & ~odd; group; group &= group - 1) squares[count++] = group & -group;
+
+    int best_eval = NO_MOVE;
+    for (uint64_t move : squares) {
+        uint64_t flipped = Board::flips(player, opponent, move);
+        if (flipped) {
+            int eval = -solve_2(opponent ^ flipped, player | flipped | move, -beta, -alpha, false);
+            if (eval > best_eval) {
+                best_eval = eval;
+                if (eval >= beta) {
+                    return best_eval;
+                }
+                alpha = std::max(eval, alpha);
+            }
+        }
+    }
+
+    if (best_eval == NO_MOVE) {
+        if (passed) {
+            return final_score(player, opponent);
+        }
+        return -solve_3(opponent, player, -beta, -alpha, true);
+    }
+    return best_eval;
+}
+
+int Endgame::solve_2(uint64_t player, uint64_t opponent, int alpha, int beta, bool passed) {
+    state_count++;
+
+    uint64_t empty = ~(player | opponent);
+    uint64_t first = empty & -empty;
+    uint64_t second = empty ^ first;
+
+    int best_eval = NO_MOVE;
+    uint64_t flipped = Board::flips(player, opponent, first);
+    if (flipped) {
+        best_eval = -solve_1(opponent ^ flipped, player | flipped | first, second);
+        if (best_eval >= beta) {
+            return best_eval;
+        }
+    }
+    flipped = Board::flips(player, opponent, second);
+    if (flipped) {
+        best_eval = std::max(-solve_1(opponent ^ flipped, player | flipped | second, first), best_eval);
+    }
+
+    if (best_eval == NO_MOVE) {
+        if (passed) {
+            return final_score(player, opponent);
+        }
+        return -solve_2(opponent, player, -beta, -alpha, true);
+    }
+    return best_eval;
+}
+
+int Endgame::solve_1(uint64_t player, uint64_t opponent, uint64_t square) {
+    state_count++;
+
+    // only the flips are counted, the board itself is never updated
+    int score = std::popcount(player) - std::popcount(opponent);
+    uint64_t flipped = Board::flips(player, opponent, square);
+    if (flipped) {
+        return score + 2 * std::popcount(flipped) + 1;
+    }
+    flipped = Board::flips(opponent, player, square);
+    if (flipped) {
+        return score - 2 * std::popcount(flipped) - 1;
+    }
+    // nobody can move, 63 pieces never draw and the empty goes to the winner
+    return score > 0 ? score + 1 : score - 1;
+}
@@ -0,0 +1,355 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "engine/lazy_smp.h"
+#include <iostream>
+#include <algorithm>
+
+// alternate order is the other optimized order, so helpers do not share the first moves
+static const uint8_t *alternate(const uint8_t *order) {
+    return order == Move_order::Orders::OPTIMIZED2 ? Move_order::Orders::OPTIMIZED : Move_order::Orders::OPTIMIZED2;
+}
+
+// main thread is part of the search, so only thread_count-1 helpers are created
+LazySMP::LazySMP(Engine::Settings settings) :
+    move_order(settings.order),
+    alternate_order(alternate(settings.order)),
+    transposition_table(settings.transposition_enable ? settings.hash_size : 0, settings.transposition_enable ? settings.hash_file : nullptr),
+    manager(settings.thread_count - 1),
+    workers(settings.thread_count),
+    time_control(false),
+    stop(false)
+{
+    this->settings = settings;
+}
+
+uint64_t LazySMP::search(Board state, bool color) {
+    auto start = std::chrono::steady_clock::now();
+
+    // transposition table is kept between moves, results of older searches are only marked as stale
+    transposition_table.new_search();
+
+    // first iteration of the main thread always completes, so there is always a move to return
+    deadline = start + std::chrono::milliseconds(settings.time_limit);
+    time_control = false;
+    stop = false;
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        Worker &worker = workers[i];
+        worker.id = static_cast<int>(i);
+        worker.move_order = (worker.id % 2) ? &alternate_order : &move_order;
+        worker.state_count = 0;
+        worker.best_move = 0;
+        worker.best_eval = 0;
+        worker.completed_depth = 0;
+        worker.root = state;
+        worker.color = color;
+        worker.obj = this;
+        worker.history.new_search();
+        worker.pv.new_search();
+        worker.line.clear();
+    }
+
+    if (state.find_moves(color) != 0) {
+        for (size_t i = 1; i < workers.size(); ++i) {
+            manager.add_task(search_thread, static_cast<void*>(&workers[i]));
+        }
+        iterative_deepening(workers[0], start);
+        // helpers stop as soon as the main thread is done
+        stop.store(true, std::memory_order_relaxed);
+        manager.join();
+    }
+
+    // deepest completed iteration wins, main thread wins ties
+    const Worker *best = &workers[0];
+    unsigned long long int state_count = 0;
+    for (const Worker &worker : workers) {
+        state_count += worker.state_count;
+        if (worker.completed_depth > best->completed_depth) {
+            best = &worker;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Went through " << state_count << " states.\n";
+    std::cout << "Speed        " << static_cast<unsigned long long int>(state_count / seconds) << " states/s.\n";
+    std::cout << "Depth        " << best->completed_depth << '\n';
+    std::cout << "PV           " << PV_table::to_string(best->line) << '\n';
+    std::cout << best->best_eval << '\n';
+    last_pv = best->line;
+    return best->best_move;
+}
+
+void LazySMP::search_thread(void *args) {
+    Worker *worker = static_cast<Worker*>(args);
+    worker->obj->iterative_deepening(*worker, std::chrono::steady_clock::now());
+}
+
+void LazySMP::iterative_deepening(Worker &worker, std::chrono::steady_clock::time_point start) {
+    // every other helper runs one ply ahead
+    int offset = worker.id % 2;
+    for (int depth = 1 + offset; depth <= settings.search_depth; ++depth) {
+        uint64_t move;
+        worker.pv.new_iteration(worker.line);
+        int eval = search_aspiration(worker, depth, worker.best_eval, worker.best_move, move);
+        if (stop.load(std::memory_order_relaxed)) {
+            break;
+        }
+        worker.best_move = move;
+        worker.best_eval = eval;
+        worker.completed_depth = depth;
+        worker.line = worker.pv.line();
+        if (settings.transposition_enable) {
+            PV_table::extend(worker.line, worker.root, worker.color, depth, transposition_table);
+        }
+
+        // the first thread reaching full depth ends the search for everyone
+        if (depth == settings.search_depth) {
+            stop.store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        // only main thread decides about time, helpers follow its stop signal
+        if (worker.id == 0 && settings.time_limit > 0) {
+            // next iteration takes several times longer, there is no point in starting it
+            // when more than half of the time is gone
+            auto now = std::chrono::steady_clock::now();
+            if (now - start > (deadline - start) / 2) {
+                break;
+            }
+            time_control = true;
+        }
+    }
+}
+
+int LazySMP::search_aspiration(Worker &worker, int depth, int guess, uint64_t first_move, uint64_t &best_move) {
+    // first iterations are too unstable to guess the score
+    if (settings.aspiration_window <= 0 || depth < ASPIRATION_MIN_DEPTH) {
+        return search_root(worker, depth, -1000, 1000, first_move, best_move);
+    }
+
+    int delta = settings.aspiration_window;
+    int alpha = std::max(guess - delta, -1000);
+    int beta = std::min(guess + delta, 1000);
+    while (true) {
+        int eval = search_root(worker, depth, alpha, beta, first_move, best_move);
+        if (stop.load(std::memory_order_relaxed)) {
+            return eval;
+        }
+        // widen the window on the failing side until the score fits in
+        delta *= settings.aspiration_growth;
+        if (eval <= alpha && alpha > -1000) {
+            alpha = std::max(eval - delta, -1000);
+        }
+        else if (eval >= beta && beta < 1000) {
+            // move which failed high is the best candidate so far
+            beta = std::min(eval + delta, 1000);
+            first_move = best_move;
+        }
+        else {
+            return eval;
+        }
+    }
+}
+
+int LazySMP::search_root(Worker &worker, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move) {
+    // kernels search in negamax form, for black the window and the score are turned around
+    if (worker.color) {
+        return search_root<true>(worker, depth, alpha, beta, first_move, best_move);
+    }
+    return -search_root<false>(worker, depth, -beta, -alpha, first_move, best_move);
+}
+
+template <bool COLOR>
+int LazySMP::search_root(Worker &worker, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move) {
+    const Board &state = worker.root;
+    uint64_t moves[64];
+    int move_count = worker.move_order->sort(state.find_moves<COLOR>(), first_move, moves);
+
+    // helpers start with different root moves, best move of previous iteration stays first
+    if (worker.id > 0 && move_count > 2) {
+        std::rotate(moves + 1, moves + 1 + (worker.id % (move_count - 1)), moves + move_count);
+    }
+
+    // every score beats -1000, so the first move is always taken
+    int best_eval = -1000;
+    int eval;
+    Board next;
+    worker.pv.new_root();
+
+    best_move = 0;
+    for (int i = 0; i < move_count; ++i) {
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        worker.pv.follow_move(0, move);
+
+        if (i == 0) { // run first move with whole window
+            eval = -negascout<!COLOR>(worker, next, depth-1, 1, -beta, -alpha, false);
+        }
+        else {
+            eval = -negascout<!COLOR>(worker, next, depth-1, 1, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -negascout<!COLOR>(worker, next, depth-1, 1, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_move = move;
+            best_eval = eval;
+        }
+        if (eval > alpha && eval < beta) {
+            worker.pv.update(0, move);
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            break;
+        }
+    }
+    return best_eval;
+}
+
+std::vector<uint64_t> LazySMP::get_pv() const {
+    return last_pv;
+}
+
+void LazySMP::print_stats() const {
+#ifdef TT_STATS
+    if (settings.transposition_enable) {
+        transposition_table.print_stats();
+    }
+#endif
+}
+
+template <bool COLOR>
+int LazySMP::negascout(Worker &worker, const Board &state, int depth, int ply, int alpha, int beta, bool end_board) {
+    int init_alpha = alpha;
+    int init_beta = beta;
+    uint64_t hash = 0;
+    uint64_t hash_move = 0;
+    worker.state_count++;
+
+    // clock is read only by the main thread once in a while, unfinished iterations are then thrown away
+    if (worker.id == 0 && time_control && (worker.state_count & 0xfff) == 0 && std::chrono::steady_clock::now() >= deadline) {
+        stop.store(true, std::memory_order_relaxed);
+    }
+    if (stop.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    // line below the node is built again, nodes cut off early leave it empty
+    worker.pv.clear(ply);
+
+    // reach max depth
+    if (depth == 0) {
+        return relative<COLOR>(state.rate_board());
+    }
+
+    // moves are generated before the transposition table probe,
+    // so bucket prefetched by parent node has time to arrive
+    uint64_t possible_moves = state.find_moves<COLOR>();
+
+    // check if state was already calculated
+    // overhead of using transposition table becomes
+    // too large at lower levels, it is then faster
+    // to just calculate the score again
+    if (settings.transposition_enable && depth > 2) {
+        hash = state.hash<COLOR>();
+        int score = probe<COLOR>(transposition_table, hash, state, alpha, beta, depth, hash_move);
+        if (score != TranspositionTableParallel::NOT_FOUND) {
+            return score;
+        }
+    }
+
+    // if there are no possible moves
+    int eval;
+    if (possible_moves == 0) {
+        if (end_board) {
+            int count_white = state.count_white();
+            int count_black = state.count_black();
+            if (count_white > count_black) {eval = 999;}
+            else if (count_white < count_black) {eval = -999;}
+            else {eval = 0;}
+            eval = relative<COLOR>(eval);
+        }
+        else {
+            eval = -negascout<!COLOR>(worker, state, depth, ply, -beta, -alpha, true);
+        }
+        return eval;
+    }
+
+    // children probe the transposition table only above depth 2
+    bool prefetch = settings.transposition_enable && settings.prefetch_enable && depth > 3;
+
+    // nodes on the principal variation of the previous iteration search its move first,
+    // other nodes the move stored in transposition table, then killers and history
+    uint64_t first_move = worker.pv.first_move(ply);
+    if ((first_move & possible_moves) == 0) {
+        first_move = hash_move;
+    }
+    uint64_t moves[64];
+    int move_count;
+    if (depth >= HISTORY_MIN_DEPTH) {
+        move_count = worker.history.sort(*worker.move_order, state, COLOR, possible_moves, first_move, moves);
+    }
+    else {
+        move_count = worker.move_order->sort(possible_moves, first_move, moves);
+    }
+
+    int best_eval = -1000;
+    uint64_t best_move = 0;
+    Board next;
+    for (int i = 0; i < move_count; ++i) {
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        if (prefetch) {
+            transposition_table.prefetch(next.hash<!COLOR>());
+        }
+        worker.pv.follow_move(ply, move);
+
+        if (i == 0) { // run first move with whole window
+            eval = -negascout<!COLOR>(worker, next, depth-1, ply+1, -beta, -alpha, false);
+        }
+        else {
+            eval = -negascout<!COLOR>(worker, next, depth-1, ply+1, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -negascout<!COLOR>(worker, next, depth-1, ply+1, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
+        }
+        if (eval > alpha && eval < beta) {
+            worker.pv.update(ply, move);
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            worker.history.update(state, COLOR, move, depth);
+            break;
+        }
+    }
+
+    // save the score for future, results of interrupted search are not valid
+    if (settings.transposition_enable && depth > 2 && !stop.load(std::memory_order_relaxed)) {
+        store<COLOR>(transposition_table, hash, state, best_eval, init_alpha, init_beta, depth, best_move);
+    }
+
+    return best_eval;
+}
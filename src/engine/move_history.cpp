@@ -0,0 +1,88 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "engine/move_history.h"
+#include <bit>
+
+Move_history::Move_history() : killers(), history() {}
+
+void Move_history::new_search() {
+    for (auto &slots : killers) {
+        slots[0] = 0;
+        slots[1] = 0;
+    }
+    // old history is still a good hint, but new cutoffs should win quickly
+    age();
+}
+
+void Move_history::age() {
+    for (auto &side : history) {
+        for (uint32_t &score : side) {
+            score >>= 1;
+        }
+    }
+}
+
+void Move_history::update(const Board &state, bool color, uint64_t move, int depth) {
+    int ply = std::popcount(state.white() | state.black());
+    if (killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    uint32_t &score = history[color][std::countr_zero(move)];
+    score += depth * depth;
+    if (score > HISTORY_LIMIT) {
+        age();
+    }
+}
+
+int Move_history::sort(const Move_order &order, const Board &state, bool color, uint64_t possible_moves, uint64_t first_move, uint64_t *moves) const {
+    int count = 0;
+    if (possible_moves & first_move) {
+        moves[count++] = first_move;
+        possible_moves ^= first_move;
+    }
+    int start = count;
+
+    int ply = std::popcount(state.white() | state.black());
+    uint64_t killer = killers[ply][0];
+    uint64_t killer2 = killers[ply][1];
+    const uint32_t *side = history[color];
+
+    // moves come in the static order and insertion sort is stable,
+    // so the static order decides between moves with the same score
+    uint32_t scores[64];
+    for (uint64_t move : order) {
+        if ((possible_moves & move) == 0) {
+            continue;
+        }
+        uint32_t score;
+        if (move == killer) score = KILLER_SCORE;
+        else if (move == killer2) score = KILLER2_SCORE;
+        else score = side[std::countr_zero(move)];
+
+        int i = count++;
+        for (; i > start && scores[i-1] < score; --i) {
+            moves[i] = moves[i-1];
+            scores[i] = scores[i-1];
+        }
+        moves[i] = move;
+        scores[i] = score;
+    }
+    return count;
+}
@@ -15,6 +15,15 @@
     along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
 */
 
+// Compiller suggestion for LTO inlining
+#if defined(__GNUC__) || defined(__clang__)
+    #define ALWAYS_INLINE __attribute__((always_inline))
+#elif defined(_MSC_VER)
+    #define ALWAYS_INLINE __forceinline
+#else
+    #define ALWAYS_INLINE
+#endif
+
 #include "engine/move_order.h"
 #include <iostream>
 
@@ -48,3 +57,17 @@ Move_order::Move_order(const std::vector<uint8_t>& order) {
         }
     }
 }
+
+ALWAYS_INLINE int Move_order::sort(uint64_t possible_moves, uint64_t first_move, uint64_t *moves) const {
+    int count = 0;
+    if (possible_moves & first_move) {
+        moves[count++] = first_move;
+        possible_moves ^= first_move;
+    }
+    for (uint64_t move : move_order) {
+        if (possible_moves & move) {
+            moves[count++] = move;
+        }
+    }
+    return count;
+}
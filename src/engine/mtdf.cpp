@@ -0,0 +1,244 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "engine/mtdf.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+// initialize stats counters and select move order
+Mtdf::Mtdf(Engine::Settings settings) : total_heuristic_count(0), total_state_count(0), last_pass_count(0), move_order(settings.order), transposition_table(settings.transposition_enable ? settings.hash_size : 0, settings.transposition_enable ? settings.hash_file : nullptr), time_control(false), stop(false) {
+    this->settings = settings;
+}
+
+uint64_t Mtdf::search(Board state, bool color) {
+    auto start = std::chrono::steady_clock::now();
+
+    // transposition table is kept between moves, results of older searches are only marked as stale
+    transposition_table.new_search();
+    move_history.new_search();
+
+    // reset stats counters
+    last_heuristic_count = 0;
+    last_state_count = 0;
+    last_pass_count = 0;
+
+    // first iteration always completes, so there is always a move to return
+    deadline = start + std::chrono::milliseconds(settings.time_limit);
+    time_control = false;
+    stop = false;
+
+    uint64_t best_move = 0;
+    int best_eval = 0;
+    int completed_depth = 0;
+    // scores of odd and even depths differ a lot, iteration two plies back is the better guess
+    int evals[2] = {0, 0};
+    if (state.find_moves(color) != 0) {
+        for (int depth = 1; depth <= settings.search_depth; ++depth) {
+            uint64_t move;
+            int eval = search_mtdf(state, color, depth, evals[depth & 1], best_move, move);
+            if (stop) {
+                break;
+            }
+            best_move = move;
+            best_eval = eval;
+            evals[depth & 1] = eval;
+            completed_depth = depth;
+
+            if (settings.time_limit > 0) {
+                // next iteration takes several times longer, there is no point in starting it
+                // when more than half of the time is gone
+                auto now = std::chrono::steady_clock::now();
+                if (now - start > (deadline - start) / 2) {
+                    break;
+                }
+                time_control = true;
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Went through " << last_state_count     << " states.\n";
+    std::cout << "Analyzed     " << last_heuristic_count << " states.\n";
+    std::cout << "Speed        " << static_cast<unsigned long long int>(last_state_count / seconds) << " states/s.\n";
+    std::cout << "Depth        " << completed_depth << '\n';
+    std::cout << "Passes       " << last_pass_count << '\n';
+    std::cout << best_eval << '\n';
+    total_heuristic_count += last_heuristic_count;
+    total_state_count += last_state_count;
+    return best_move;
+}
+
+void Mtdf::print_stats() const {
+#ifdef TT_STATS
+    if (settings.transposition_enable) {
+        transposition_table.print_stats();
+    }
+#endif
+}
+
+int Mtdf::search_mtdf(const Board &state, bool color, int depth, int guess, uint64_t first_move, uint64_t &best_move) {
+    // only used when every pass fails on the wrong side, all moves then have the same score
+    uint64_t possible_moves = state.find_moves(color);
+    best_move = first_move != 0 ? first_move : possible_moves & -possible_moves;
+
+    int lower = -1000;
+    int upper = 1000;
+    int eval = std::clamp(guess, -999, 999);
+    while (lower < upper) {
+        int beta = eval == lower ? eval + 1 : eval;
+        eval = search_root(state, color, depth, beta, best_move, best_move);
+        if (stop) {
+            return eval;
+        }
+        last_pass_count++;
+        if (eval < beta) {
+            upper = eval;
+        }
+        else {
+            lower = eval;
+        }
+    }
+    return eval;
+}
+
+int Mtdf::search_root(const Board &state, bool color, int depth, int beta, uint64_t first_move, uint64_t &best_move) {
+    // kernels search in negamax form, for black the null window (beta-1, beta) turns
+    // into (-beta, -beta+1), the test value is always the upper end of the window
+    if (color) {
+        return search_root<true>(state, depth, beta, first_move, best_move);
+    }
+    return -search_root<false>(state, depth, -beta+1, first_move, best_move);
+}
+
+template <bool COLOR>
+int Mtdf::search_root(const Board &state, int depth, int beta, uint64_t first_move, uint64_t &best_move) {
+    uint64_t moves[64];
+    int move_count = move_order.sort(state.find_moves<COLOR>(), first_move, moves);
+
+    int best_eval = -1000;
+    int eval;
+    Board next;
+
+    for (int i = 0; i < move_count; ++i) {
+        next = state;
+        next.play_move<COLOR>(moves[i]);
+        eval = -alphabeta<!COLOR>(next, depth-1, -beta, -beta+1, false);
+        best_eval = std::max(eval, best_eval);
+        if (eval >= beta) {
+            best_move = moves[i];
+            break;
+        }
+    }
+    return best_eval;
+}
+
+template <bool COLOR>
+int Mtdf::alphabeta(const Board &state, int depth, int alpha, int beta, bool end_board) {
+    int init_alpha = alpha;
+    int init_beta = beta;
+    uint64_t hash = 0;
+    uint64_t hash_move = 0;
+    last_state_count++;
+
+    // clock is read only once in a while, unfinished iteration is then thrown away
+    if (time_control && (last_state_count & 0xfff) == 0 && std::chrono::steady_clock::now() >= deadline) {
+        stop = true;
+    }
+    if (stop) {
+        return 0;
+    }
+
+    // reach max depth
+    if (depth == 0) {
+        last_heuristic_count++;
+        return relative<COLOR>(state.rate_board());
+    }
+
+    // moves are generated before the transposition table probe,
+    // so bucket prefetched by parent node has time to arrive
+    uint64_t possible_moves = state.find_moves<COLOR>();
+
+    // passes revisit the same nodes with different windows,
+    // bounds stored by earlier passes cut most of them off
+    if (settings.transposition_enable && depth > 2) {
+        hash = state.hash<COLOR>();
+        int score = probe<COLOR>(transposition_table, hash, state, alpha, beta, depth, hash_move);
+        if (score != TranspositionTable::NOT_FOUND) {
+            return score;
+        }
+    }
+
+    // if there are no possible moves
+    int eval;
+    if (possible_moves == 0) {
+        if (end_board) {
+            int count_white = state.count_white();
+            int count_black = state.count_black();
+            if (count_white > count_black) {eval = 999;}
+            else if (count_white < count_black) {eval = -999;}
+            else {eval = 0;}
+            eval = relative<COLOR>(eval);
+        }
+        else {
+            eval = -alphabeta<!COLOR>(state, depth, -beta, -alpha, true);
+        }
+        return eval;
+    }
+
+    // children probe the transposition table only above depth 2
+    bool prefetch = settings.transposition_enable && settings.prefetch_enable && depth > 3;
+
+    // move stored in transposition table is searched first, then killers and history
+    uint64_t moves[64];
+    int move_count;
+    if (depth >= HISTORY_MIN_DEPTH) {
+        move_count = move_history.sort(move_order, state, COLOR, possible_moves, hash_move, moves);
+    }
+    else {
+        move_count = move_order.sort(possible_moves, hash_move, moves);
+    }
+
+    int best_eval = -1000;
+    uint64_t best_move = 0;
+    Board next;
+    for (int i = 0; i < move_count; ++i) {
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        if (prefetch) {
+            transposition_table.prefetch(next.hash<!COLOR>());
+        }
+        eval = -alphabeta<!COLOR>(next, depth-1, -beta, -alpha, false);
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            move_history.update(state, COLOR, move, depth);
+            break;
+        }
+    }
+
+    // save the score for future, results of interrupted search are not valid
+    if (settings.transposition_enable && depth > 2 && !stop) {
+        store<COLOR>(transposition_table, hash, state, best_eval, init_alpha, init_beta, depth, best_move);
+    }
+
+    return best_eval;
+}
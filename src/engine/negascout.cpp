@@ -20,117 +20,327 @@
 #include <bit>
 #include <vector>
 #include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
 
 // initialize stats counters and select move order
-Negascout::Negascout(Engine::Settings settings) : total_heuristic_count(0), total_state_count(0), move_order(settings.order) {
+Negascout::Negascout(Engine::Settings settings) : total_heuristic_count(0), total_state_count(0), last_research_count(0), last_etc_count(0), last_probcut_count(0), last_iid_count(0), last_lmr_research_count(0), move_order(settings.order), transposition_table(settings.transposition_enable ? settings.hash_size : 0, settings.transposition_enable ? settings.hash_file : nullptr), endgame(settings.transposition_enable ? &transposition_table : nullptr, &stop), time_control(false), stop(false), ponder_color(false) {
     this->settings = settings;
+
+    // reductions grow with depth and rank, one ply for the first reduced moves
+    for (int depth = 0; depth < 64; ++depth) {
+        for (int rank = 0; rank < 64; ++rank) {
+            int reduction = 0;
+            if (settings.lmr_rank > 0 && depth >= settings.lmr_min_depth && rank >= settings.lmr_rank) {
+                reduction = 1 + static_cast<int>(std::log(depth) * std::log(rank - settings.lmr_rank + 1) / settings.lmr_divisor);
+                // reduced search has to stay at least one ply deep
+                reduction = std::min({reduction, settings.lmr_max_reduction, depth - 2});
+            }
+            lmr_table[depth][rank] = static_cast<uint8_t>(reduction);
+        }
+    }
+}
+
+Negascout::~Negascout() {
+    if (ponder_result.valid()) {
+        ponder_miss();
+    }
 }
 
 uint64_t Negascout::search(Board state, bool color) {
-    // transposition table must be empty before calculation of best move, otherwise results would be affected
-    transposition_table.clear();
+    stop = false;
+    return run_search(state, color, false, std::cout);
+}
+
+bool Negascout::ponder(const Board &state, bool color) {
+    if (!settings.ponder_enable) {
+        return false;
+    }
+    ponder_state = state;
+    ponder_color = color;
+    ponder_output.str("");
+    ponder_start = std::chrono::steady_clock::now();
+
+    // stop flag is reset here, so miss coming before the thread starts is not lost
+    stop = false;
+    ponder_result = std::async(std::launch::async, [this]() {
+        return run_search(ponder_state, ponder_color, true, ponder_output);
+    });
+    return true;
+}
+
+uint64_t Negascout::ponder_hit() {
+    // time limit runs from the start of pondering, the search had at least as much time as a regular one
+    // when the player thought long enough and it stops right away
+    if (settings.time_limit > 0) {
+        auto deadline = ponder_start + std::chrono::milliseconds(settings.time_limit);
+        if (ponder_result.wait_until(deadline) == std::future_status::timeout) {
+            stop = true;
+        }
+    }
+    uint64_t best_move = ponder_result.get();
+    if (best_move == 0) {
+        // stopped before the first iteration completed
+        return search(ponder_state, ponder_color);
+    }
+    std::cout << "Ponder hit\n" << ponder_output.str();
+    return best_move;
+}
+
+void Negascout::ponder_miss() {
+    stop = true;
+    ponder_result.get();
+}
+
+uint64_t Negascout::run_search(Board state, bool color, bool pondering, std::ostream &out) {
+    auto start = std::chrono::steady_clock::now();
+
+    // transposition table is kept between moves, results of older searches are only marked as stale
+    transposition_table.new_search();
+    move_history.new_search();
+    pv.new_search();
+    last_pv.clear();
     
     // reset stats counters
     last_heuristic_count = 0;
     last_state_count = 0;
+    last_research_count = 0;
+    last_etc_count = 0;
+    last_probcut_count = 0;
+    last_lmr_research_count = 0;
+    last_iid_count = 0;
 
-    uint64_t best_move = 0;
-    uint64_t possible_moves = state.find_moves(color);
+    // first iteration always completes, so there is always a move to return,
+    // stop flag is reset by the caller, background search can be stopped at any time
+    deadline = start + std::chrono::milliseconds(settings.time_limit);
+    time_control = false;
 
-    int alpha = -1000;
-    int beta = 1000;
+    uint64_t best_move = 0;
     int best_eval = 0;
-    int eval;
-    bool first = true;
-    Board next;
-    
-    if (color == true && possible_moves != 0) {
-        best_eval = -1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(color, move);
-                
-                if (first) { // run first move with whole window
-                    eval = negascout(next, settings.search_depth-1, !color, alpha, beta, false);
-                    first = false;
-                }
-                else {
-                    eval = negascout(next, settings.search_depth-1, !color, alpha, alpha+1, false); // minimize search window
-                    if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
-                        eval = negascout(next, settings.search_depth-1, !color, eval, beta, false);
-                    }
-                }
+    int completed_depth = 0;
+    int empties = 64 - std::popcount(state.white() | state.black());
+    bool has_moves = state.find_moves(color) != 0;
+    bool solving = has_moves && empties <= settings.endgame_empties;
+    bool solved = false;
+    // close to the end the solver runs instead, under time limit the heuristic search
+    // goes first, so there is a move to play when the solve does not finish in time
+    if (has_moves && (!solving || settings.time_limit > 0)) {
+        for (int depth = 1; depth <= settings.search_depth; ++depth) {
+            uint64_t move;
+            pv.new_iteration(last_pv);
+            int eval = search_aspiration(state, color, depth, best_eval, best_move, move);
+            if (stop) {
+                break;
+            }
+            best_move = move;
+            best_eval = eval;
+            completed_depth = depth;
+            last_pv = pv.line();
+            if (settings.transposition_enable) {
+                PV_table::extend(last_pv, state, color, depth, transposition_table);
+            }
 
-                if (eval > best_eval) {
-                    best_move = move;
-                    best_eval = eval;
+            if (settings.time_limit > 0 && !pondering) {
+                // next iteration takes several times longer, there is no point in starting it
+                // when more than half of the time is gone
+                auto now = std::chrono::steady_clock::now();
+                if (now - start > (deadline - start) / 2) {
+                    break;
                 }
-                alpha = std::max(eval, alpha);
+                time_control = true;
             }
         }
     }
-    else if (color == false && possible_moves != 0) {
-        best_eval = 1000;
-        for (uint64_t move : move_order) {
-            if ((possible_moves & move) != 0) {
-                next = state;
-                next.play_move(color, move);
-                
-                if (first) { // run first move with whole window
-                    eval = negascout(next, settings.search_depth-1, !color, alpha, beta, false);
-                    first = false;
-                }
-                else {
-                    eval = negascout(next, settings.search_depth-1, !color, beta-1, beta, false); // minimize search window
-                    if (eval < beta && eval > alpha) { // if we missed the window and there might still be better move, rerun
-                        eval = negascout(next, settings.search_depth-1, !color, alpha, eval, false);
-                    }
-                }
-
-                if (eval < best_eval) {
-                    best_move = move;
-                    best_eval = eval;
-                }
-                beta = std::min(eval, beta);
+    if (solving && !stop) {
+        // null window around zero only proves win, loss or draw, but in fraction of the time
+        uint64_t solve_move;
+        auto solve_deadline = settings.time_limit > 0 && !pondering ? deadline : std::chrono::steady_clock::time_point::max();
+        int eval = endgame.solve(state, color, settings.endgame_wld ? -1 : -64, settings.endgame_wld ? 1 : 64, solve_move, solve_deadline);
+        last_state_count += endgame.get_state_count();
+        // aborted solve keeps the move of the last heuristic iteration
+        if (!endgame.aborted()) {
+            solved = true;
+            best_move = solve_move;
+            best_eval = eval;
+            completed_depth = empties;
+            last_pv = {best_move};
+            // solver keeps no lines, the reply is taken from the table
+            Board next = state;
+            next.play_move(color, best_move);
+            uint64_t reply = endgame.stored_move(next, !color);
+            if (reply != 0) {
+                last_pv.push_back(reply);
             }
         }
     }
 
-    std::cout << "Went through " << last_state_count     << " states.\n";
-    std::cout << "Analyzed     " << last_heuristic_count << " states.\n";
-    std::cout << best_eval << '\n';
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    out << "Went through " << last_state_count     << " states.\n";
+    out << "Analyzed     " << last_heuristic_count << " states.\n";
+    out << "Speed        " << static_cast<unsigned long long int>(last_state_count / seconds) << " states/s.\n";
+    out << "Depth        " << completed_depth << '\n';
+    out << "Researches   " << last_research_count << '\n';
+    out << "ETC cutoffs  " << last_etc_count << '\n';
+    out << "IID searches " << last_iid_count << '\n';
+    if (settings.probcut_enable) {
+        out << "Probcuts     " << last_probcut_count << '\n';
+    }
+    if (settings.lmr_rank > 0) {
+        out << "LMR re-runs  " << last_lmr_research_count << '\n';
+    }
+    out << "PV           " << PV_table::to_string(last_pv) << '\n';
+    if (solved) {
+        out << "Result       " << (best_eval > 0 ? "white wins" : best_eval < 0 ? "black wins" : "draw") << '\n';
+    }
+    out << best_eval << '\n';
     total_heuristic_count += last_heuristic_count;
     total_state_count += last_state_count;
     return best_move;
 }
 
-int Negascout::negascout(Board state, int depth, bool cur_color, int alpha, int beta, bool end_board) {
+int Negascout::search_fixed(const Board &state, bool color, int depth, uint64_t &best_move) {
+    time_control = false;
+    stop = false;
+    return search_root(state, color, depth, -1000, 1000, 0, best_move);
+}
+
+int Negascout::search_aspiration(const Board &state, bool color, int depth, int guess, uint64_t first_move, uint64_t &best_move) {
+    // first iterations are too unstable to guess the score
+    if (settings.aspiration_window <= 0 || depth < ASPIRATION_MIN_DEPTH) {
+        return search_root(state, color, depth, -1000, 1000, first_move, best_move);
+    }
+
+    int delta = settings.aspiration_window;
+    int alpha = std::max(guess - delta, -1000);
+    int beta = std::min(guess + delta, 1000);
+    while (true) {
+        int eval = search_root(state, color, depth, alpha, beta, first_move, best_move);
+        if (stop) {
+            return eval;
+        }
+        // widen the window on the failing side until the score fits in
+        delta *= settings.aspiration_growth;
+        if (eval <= alpha && alpha > -1000) {
+            alpha = std::max(eval - delta, -1000);
+        }
+        else if (eval >= beta && beta < 1000) {
+            // move which failed high is the best candidate so far
+            beta = std::min(eval + delta, 1000);
+            first_move = best_move;
+        }
+        else {
+            return eval;
+        }
+        last_research_count++;
+    }
+}
+
+int Negascout::search_root(const Board &state, bool color, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move) {
+    // kernels search in negamax form, for black the window and the score are turned around
+    if (color) {
+        return search_root<true>(state, depth, alpha, beta, first_move, best_move);
+    }
+    return -search_root<false>(state, depth, -beta, -alpha, first_move, best_move);
+}
+
+template <bool COLOR>
+int Negascout::search_root(const Board &state, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move) {
+    uint64_t moves[64];
+    int move_count = move_order.sort(state.find_moves<COLOR>(), first_move, moves);
+    pv.new_root();
+
+    // every score beats -1000, so the first move is always taken
+    int best_eval = -1000;
+    int eval;
+    Board next;
+    
+    best_move = 0;
+    for (int i = 0; i < move_count; ++i) {
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        pv.follow_move(0, move);
+        
+        if (i == 0) { // run first move with whole window
+            eval = -negascout<!COLOR>(next, depth-1, 1, -beta, -alpha, false);
+        }
+        else {
+            eval = -negascout<!COLOR>(next, depth-1, 1, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -negascout<!COLOR>(next, depth-1, 1, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_move = move;
+            best_eval = eval;
+        }
+        if (eval > alpha && eval < beta) {
+            pv.update(0, move);
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            break;
+        }
+    }
+    return best_eval;
+}
+
+std::vector<uint64_t> Negascout::get_pv() const {
+    return last_pv;
+}
+
+void Negascout::print_stats() const {
+#ifdef TT_STATS
+    if (settings.transposition_enable) {
+        transposition_table.print_stats();
+    }
+#endif
+}
+
+template <bool COLOR>
+int Negascout::negascout(const Board &state, int depth, int ply, int alpha, int beta, bool end_board) {
     int init_alpha = alpha;
     int init_beta = beta;
     uint64_t hash = 0;
+    uint64_t hash_move = 0;
     last_state_count++;
+
+    // clock is read only once in a while, unfinished iteration is then thrown away
+    if (time_control && (last_state_count & 0xfff) == 0 && std::chrono::steady_clock::now() >= deadline) {
+        stop = true;
+    }
+    if (stop) {
+        return 0;
+    }
+
+    // line below the node is built again, nodes cut off early leave it empty
+    pv.clear(ply);
     
     // reach max depth
     if (depth == 0) {
         last_heuristic_count++;
-        return state.rate_board();
+        return relative<COLOR>(state.rate_board());
     }
     
+    // moves are generated before the transposition table probe,
+    // so bucket prefetched by parent node has time to arrive
+    uint64_t possible_moves = state.find_moves<COLOR>();
+
     // check if state was already calculated
     // overhead of using transposition table becomes
     // too large at lower levels, it is then faster
     // to just calculate the score again
     if (settings.transposition_enable && depth > 2) {
-        hash = state.hash();
-        int score = transposition_table.get(hash, alpha, beta);
+        hash = state.hash<COLOR>();
+        int score = probe<COLOR>(transposition_table, hash, state, alpha, beta, depth, hash_move);
         if (score != TranspositionTable::NOT_FOUND) {
             return score;
         }
     }
 
     // if there are no possible moves
-    uint64_t possible_moves = state.find_moves(cur_color);
     int eval;
     if (possible_moves == 0) {
         if (end_board) {
@@ -139,188 +349,525 @@ int Negascout::negascout(Board state, int depth, bool cur_color, int alpha, int
             if (count_white > count_black) {eval = 999;}
             else if (count_white < count_black) {eval = -999;}
             else {eval = 0;}
+            eval = relative<COLOR>(eval);
         }
         else {
-            eval = negascout(state, depth, !cur_color, alpha, beta, true);
+            eval = -negascout<!COLOR>(state, depth, ply, -beta, -alpha, true);
         }
         return eval;
     }
 
-    int best_eval;
-    bool first = true;
-    Board next;
-    if (cur_color == true) {
-        best_eval = -1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(cur_color, move);
-                
-                if (first) { // run first move with whole window
-                    eval = negascout(next, depth-1, !cur_color, alpha, beta, false);
-                    first = false;
-                }
-                else {
-                    eval = negascout(next, depth-1, !cur_color, alpha, alpha+1, false); // minimize search window
-                    if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
-                        eval = negascout(next, depth-1, !cur_color, eval, beta, false);
-                    }
-                }
+    // shallow search predicts the result of the deep one
+    if (settings.probcut_enable && depth >= ProbCut::MIN_DEPTH && probcut<COLOR>(state, depth, ply, alpha, beta, eval)) {
+        last_probcut_count++;
+        return eval;
+    }
 
-                best_eval = std::max(eval, best_eval);
-                alpha = std::max(eval, alpha);
-                if (beta <= alpha) {
-                    break;
-                }
-            }
+    // children probe the transposition table only above depth 2
+    bool prefetch = settings.transposition_enable && settings.prefetch_enable && depth > 3;
+
+    // nodes on the principal variation of the previous iteration search its move first,
+    // other nodes the move stored in transposition table, then killers and history
+    uint64_t first_move = pv.first_move(ply);
+    if ((first_move & possible_moves) == 0) {
+        first_move = hash_move;
+    }
+
+    // internal iterative deepening, static order is a poor guess in a deep subtree,
+    // shallower search stores its best move in the table and it goes first instead
+    if (settings.transposition_enable && settings.iid_enable && first_move == 0 && depth >= IID_MIN_DEPTH) {
+        last_iid_count++;
+        negascout<COLOR>(state, depth - IID_REDUCTION, ply, alpha, beta, false);
+        if (stop) {
+            return 0;
         }
+        // stored entry is too shallow to return a score, the probe only fetches its move
+        probe<COLOR>(transposition_table, hash, state, alpha, beta, depth, first_move);
+        pv.clear(ply);
+    }
+    uint64_t moves[64];
+    int move_count;
+    if (depth >= HISTORY_MIN_DEPTH) {
+        move_count = move_history.sort(move_order, state, COLOR, possible_moves, first_move, moves);
     }
     else {
-        best_eval = 1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(cur_color, move);
-
-                if (first) { // run first move with whole window
-                    eval = negascout(next, depth-1, !cur_color, alpha, beta, false);
-                    first = false;
-                }
-                else {
-                    eval = negascout(next, depth-1, !cur_color, beta-1, beta, false); // minimize search window
-                    if (eval < beta && eval > alpha) { // if we missed the window and there might still be better move, rerun
-                        eval = negascout(next, depth-1, !cur_color, alpha, eval, false);
-                    }
-                }
-                
-                best_eval = std::min(eval, best_eval);
-                beta = std::min(eval, beta);
-                if (beta <= alpha) {
-                    break;
-                }
+        move_count = move_order.sort(possible_moves, first_move, moves);
+    }
+
+    // enhanced transposition cutoff, child already stored in the table
+    // may prove the cutoff before any child is searched
+    if (settings.transposition_enable && settings.etc_enable && depth >= ETC_MIN_DEPTH) {
+        Board children[64];
+        for (int i = 0; i < move_count; ++i) {
+            children[i] = state;
+            children[i].play_move<COLOR>(moves[i]);
+            if (prefetch) {
+                transposition_table.prefetch(children[i].hash<!COLOR>());
+            }
+        }
+        for (int i = 0; i < move_count; ++i) {
+            uint64_t child_move;
+            int score = probe<!COLOR>(transposition_table, children[i].hash<!COLOR>(), children[i], -beta, -alpha, depth-1, child_move);
+            if (score != TranspositionTable::NOT_FOUND && -score >= beta) {
+                last_etc_count++;
+                store<COLOR>(transposition_table, hash, state, -score, init_alpha, init_beta, depth, moves[i]);
+                return -score;
             }
         }
     }
+
+    int best_eval = -1000;
+    uint64_t best_move = 0;
+    Board next;
+    for (int i = 0; i < move_count; ++i) {
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        if (prefetch) {
+            transposition_table.prefetch(next.hash<!COLOR>());
+        }
+        pv.follow_move(ply, move);
+        
+        if (i == 0) { // run first move with whole window
+            eval = -negascout<!COLOR>(next, depth-1, ply+1, -beta, -alpha, false);
+        }
+        else {
+            int reduction = lmr_table[std::min(depth, 63)][i];
+            eval = -negascout<!COLOR>(next, depth-1-reduction, ply+1, -alpha-1, -alpha, false); // minimize search window
+            if (reduction > 0 && eval > alpha) { // reduced search is not trusted, verify at full depth
+                last_lmr_research_count++;
+                eval = -negascout<!COLOR>(next, depth-1, ply+1, -alpha-1, -alpha, false);
+            }
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -negascout<!COLOR>(next, depth-1, ply+1, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
+        }
+        if (eval > alpha && eval < beta) {
+            pv.update(ply, move);
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            move_history.update(state, COLOR, move, depth);
+            break;
+        }
+    }
     
-    // save the score for future
-    if (settings.transposition_enable && depth > 2) {
-        transposition_table.insert(hash, best_eval, init_alpha, init_beta);
+    // save the score for future, results of interrupted search are not valid
+    if (settings.transposition_enable && depth > 2 && !stop) {
+        store<COLOR>(transposition_table, hash, state, best_eval, init_alpha, init_beta, depth, best_move);
     }
 
     return best_eval;
 }
 
-// initialize stats counters and select move order
-NegascoutParallel::NegascoutParallel(Engine::Settings settings) : move_order(settings.order), manager(settings.thread_count) {
+template <bool COLOR>
+bool Negascout::probcut(const Board &state, int depth, int ply, int alpha, int beta, int &eval) {
+    const ProbCut::Params *params = ProbCut::get(state, depth);
+    if (params == nullptr) {
+        return false;
+    }
+    int shallow = ProbCut::shallow_depth(depth);
+    float margin = ProbCut::THRESHOLD * params->sigma;
+
+    // regression is fitted relative to the player at turn, it applies to the window as it is
+    // deep score is very likely at least beta, shallow search has to prove the bound
+    if (beta < 999) {
+        int bound = static_cast<int>(std::ceil((beta + margin - params->b) / params->a));
+        if (bound < 999) {
+            int score = negascout<COLOR>(state, shallow, ply, bound-1, bound, false);
+            if (stop) {
+                return false;
+            }
+            if (score >= bound) {
+                eval = beta;
+                return true;
+            }
+        }
+    }
+
+    // deep score is very likely at most alpha
+    if (alpha > -999) {
+        int bound = static_cast<int>(std::floor((alpha - margin - params->b) / params->a));
+        if (bound > -999) {
+            int score = negascout<COLOR>(state, shallow, ply, bound, bound+1, false);
+            if (stop) {
+                return false;
+            }
+            if (score <= bound) {
+                eval = alpha;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// main thread is part of the search, so only thread_count-1 helpers are created
+NegascoutParallel::NegascoutParallel(Engine::Settings settings) :
+    move_order(settings.order),
+    transposition_table(settings.transposition_enable ? settings.hash_size : 0, settings.transposition_enable ? settings.hash_file : nullptr),
+    manager(settings.thread_count - 1),
+    workers(settings.thread_count),
+    idle_count(0),
+    search_done(false),
+    time_control(false),
+    stop(false)
+{
     this->settings = settings;
 }
 
-void NegascoutParallel::search_move(void *args) {
-    SearchArg *args_ = (SearchArg*) args;
-    int eval;
-    Board next = args_->state;
-    next.play_move(args_->cur_color, args_->move);
-
-    // load latest alpha beta values
-    args_->obj->m.lock();
-    int alpha_loc = *(args_->alpha);
-    int beta_loc = *(args_->beta);
-    args_->obj->m.unlock();
-
-    // run the search
-    if (args_->cur_color) {
-            eval = args_->obj->negascout(next, args_->obj->settings.search_depth-1, !(args_->cur_color), alpha_loc, alpha_loc+1, false); // minimize search window
-            if (eval > alpha_loc && eval < beta_loc) { // if we missed the window and there might still be better move, rerun
-                eval = args_->obj->negascout(next, args_->obj->settings.search_depth-1, !(args_->cur_color), eval, beta_loc, false);
-            }
+uint64_t NegascoutParallel::search(Board state, bool color) {
+    auto start = std::chrono::steady_clock::now();
+
+    // transposition table is kept between moves, results of older searches are only marked as stale
+    transposition_table.new_search();
+
+    // first iteration always completes, so there is always a move to return
+    deadline = start + std::chrono::milliseconds(settings.time_limit);
+    time_control = false;
+    stop = false;
+
+    for (Worker &worker : workers) {
+        worker.state_count = 0;
+        worker.split = nullptr;
+        worker.obj = this;
+        worker.history.new_search();
     }
-    else { 
-            eval = args_->obj->negascout(next, args_->obj->settings.search_depth-1, !(args_->cur_color), beta_loc-1, beta_loc, false); // minimize search window
-            if (eval < beta_loc && eval > alpha_loc) { // if we missed the window and there might still be better move, rerun
-                eval = args_->obj->negascout(next, args_->obj->settings.search_depth-1, !(args_->cur_color), alpha_loc, eval, false);
+
+    uint64_t best_move = 0;
+    int best_eval = 0;
+    if (state.find_moves(color) != 0) {
+        // helpers wait for split points during the whole search
+        search_done = false;
+        for (size_t i = 1; i < workers.size(); ++i) {
+            manager.add_task(helper_thread, static_cast<void*>(&workers[i]));
+        }
+
+        for (int depth = 1; depth <= settings.search_depth; ++depth) {
+            uint64_t move;
+            int eval = search_aspiration(state, color, depth, best_eval, best_move, move);
+            if (stop) {
+                break;
+            }
+            best_move = move;
+            best_eval = eval;
+
+            if (settings.time_limit > 0) {
+                // next iteration takes several times longer, there is no point in starting it
+                // when more than half of the time is gone
+                auto now = std::chrono::steady_clock::now();
+                if (now - start > (deadline - start) / 2) {
+                    break;
+                }
+                time_control = true;
             }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(split_mutex);
+            search_done = true;
+        }
+        split_cond.notify_all();
+        manager.join();
     }
 
-    // update alpha beta values
-    args_->obj->m.lock();
-    if (args_->cur_color) *(args_->alpha) = std::max(eval, alpha_loc);
-    else *(args_->beta) = std::min(eval, beta_loc);
-    args_->obj->m.unlock();
+    unsigned long long int state_count = 0;
+    for (const Worker &worker : workers) {
+        state_count += worker.state_count;
+    }
 
-    // save search result
-    args_->ret = eval;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Went through " << state_count << " states.\n";
+    std::cout << "Speed        " << static_cast<unsigned long long int>(state_count / seconds) << " states/s.\n";
+    std::cout << best_eval << '\n';
+    return best_move;
 }
 
-uint64_t NegascoutParallel::search(Board state, bool color) {
-    // transposition table must be empty before calculation of best move, otherwise results would be affected
-    transposition_table.clear();
+int NegascoutParallel::search_aspiration(const Board &state, bool color, int depth, int guess, uint64_t first_move, uint64_t &best_move) {
+    // first iterations are too unstable to guess the score
+    if (settings.aspiration_window <= 0 || depth < ASPIRATION_MIN_DEPTH) {
+        return search_root(state, color, depth, -1000, 1000, first_move, best_move);
+    }
+
+    int delta = settings.aspiration_window;
+    int alpha = std::max(guess - delta, -1000);
+    int beta = std::min(guess + delta, 1000);
+    while (true) {
+        int eval = search_root(state, color, depth, alpha, beta, first_move, best_move);
+        if (stop) {
+            return eval;
+        }
+        // widen the window on the failing side until the score fits in
+        delta *= settings.aspiration_growth;
+        if (eval <= alpha && alpha > -1000) {
+            alpha = std::max(eval - delta, -1000);
+        }
+        else if (eval >= beta && beta < 1000) {
+            // move which failed high is the best candidate so far
+            beta = std::min(eval + delta, 1000);
+            first_move = best_move;
+        }
+        else {
+            return eval;
+        }
+    }
+}
 
-    // prepare vectors for holding results from the threads
-    uint64_t possible_moves = state.find_moves(color);
-    uint64_t possible_moves_count = std::popcount(possible_moves);
-    std::vector<SearchArg> evals(possible_moves_count);
-    std::vector<uint64_t> moves(possible_moves_count);
+int NegascoutParallel::search_root(const Board &state, bool color, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move) {
+    // kernels search in negamax form, for black the window and the score are turned around
+    if (color) {
+        return search_root<true>(state, depth, alpha, beta, first_move, best_move);
+    }
+    return -search_root<false>(state, depth, -beta, -alpha, first_move, best_move);
+}
 
-    // initialize alpha beta values
-    int alpha = -1000;
-    int beta = 1000;
-    bool first = true;
+template <bool COLOR>
+int NegascoutParallel::search_root(const Board &state, int depth, int alpha, int beta, uint64_t first_move, uint64_t &best_move) {
+    Worker &worker = workers[0];
+    uint64_t moves[64];
+    int move_count = move_order.sort(state.find_moves<COLOR>(), first_move, moves);
 
-    int id = 0;
-    
-    for (uint64_t move : move_order) {
-        if (possible_moves & move) {
-            // save info about the move
-            SearchArg arg = {state, move, color, &alpha, &beta, 0, this};
-            moves[id] = move;
-            evals[id] = arg;
-            // first move does not run in parallel in order to not completely kill pruning performance
-            if (first) {
-                Board next = state;
-                next.play_move(color, move);
-                int res = negascout(next, settings.search_depth-1, !color, alpha, beta, false);
-                if (color) alpha = res;
-                else beta = res;
-                evals[id].ret = res;
-                first = false;
+    // every score beats -1000, so the first move is always taken
+    int best_eval = -1000;
+    int eval;
+    Board next;
+
+    best_move = 0;
+    for (int i = 0; i < move_count; ++i) {
+        // younger brothers are shared once the eldest one is searched
+        if (i > 0 && depth >= SPLIT_MIN_DEPTH && i < move_count - 1 && idle_count.load(std::memory_order_relaxed) > 0) {
+            split(worker, state, depth, COLOR, moves + i, move_count - i, alpha, beta, best_eval, best_move);
+            break;
+        }
+
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+
+        if (i == 0) { // run first move with whole window
+            eval = -negascout<!COLOR>(worker, next, depth-1, -beta, -alpha, false);
+        }
+        else {
+            eval = -negascout<!COLOR>(worker, next, depth-1, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -negascout<!COLOR>(worker, next, depth-1, -beta, -eval, false);
+            }
+        }
+
+        if (eval > best_eval) {
+            best_move = move;
+            best_eval = eval;
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            break;
+        }
+    }
+    return best_eval;
+}
+
+void NegascoutParallel::print_stats() const {
+#ifdef TT_STATS
+    if (settings.transposition_enable) {
+        transposition_table.print_stats();
+    }
+#endif
+}
+
+void NegascoutParallel::helper_thread(void *args) {
+    Worker *worker = static_cast<Worker*>(args);
+    worker->obj->idle_loop(*worker, nullptr);
+}
+
+bool NegascoutParallel::aborted(const Worker &worker) const {
+    if (stop.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    // cutoff anywhere above makes the whole subtree useless
+    for (const SplitPoint *sp = worker.split; sp != nullptr; sp = sp->parent) {
+        if (sp->cutoff.load(std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+NegascoutParallel::SplitPoint *NegascoutParallel::find_split(const SplitPoint *master) const {
+    for (SplitPoint *sp : open_splits) {
+        if (sp->next_move.load(std::memory_order_relaxed) >= sp->move_count || sp->cutoff.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        if (master == nullptr) {
+            return sp;
+        }
+        // waiting owner may only help below its own split point, so it is free again
+        // as soon as its helpers are done
+        for (const SplitPoint *parent = sp->parent; parent != nullptr; parent = parent->parent) {
+            if (parent == master) {
+                return sp;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void NegascoutParallel::idle_loop(Worker &worker, SplitPoint *master) {
+    while (true) {
+        SplitPoint *sp = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(split_mutex);
+            if (master == nullptr) {
+                idle_count.fetch_add(1, std::memory_order_relaxed);
+                split_cond.wait(lock, [&]() { return search_done || (sp = find_split(nullptr)) != nullptr; });
+                idle_count.fetch_sub(1, std::memory_order_relaxed);
+                if (search_done) {
+                    return;
+                }
             }
-            // other moves are search in parallel with the help of thread manager
             else {
-                manager.add_task(search_move, static_cast<void*>(&(evals[id])));
+                if (master->helper_count.load(std::memory_order_acquire) == 0) {
+                    return;
+                }
+                sp = find_split(master);
             }
-            id++;
+            // split point is closed under the same lock, so it cannot disappear before the helper is counted
+            if (sp != nullptr) {
+                sp->helper_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (sp != nullptr) {
+            search_split(worker, *sp);
+            // owner may destroy the split point right after this
+            sp->helper_count.fetch_sub(1, std::memory_order_release);
+        }
+        else {
+            std::this_thread::yield();
         }
     }
+}
 
-    // wait until all moves are searched
-    manager.join();
+void NegascoutParallel::split(Worker &worker, const Board &state, int depth, bool cur_color, const uint64_t *moves, int move_count, int &alpha, int &beta, int &best_eval, uint64_t &best_move) {
+    SplitPoint sp;
+    sp.state = &state;
+    sp.depth = depth;
+    sp.cur_color = cur_color;
+    sp.moves = moves;
+    sp.move_count = move_count;
+    sp.next_move = 0;
+    sp.alpha = alpha;
+    sp.beta = beta;
+    sp.best_eval = best_eval;
+    sp.best_move = best_move;
+    sp.cutoff = false;
+    sp.helper_count = 0;
+    sp.parent = worker.split;
+
+    {
+        std::lock_guard<std::mutex> lock(split_mutex);
+        open_splits.push_back(&sp);
+    }
+    split_cond.notify_all();
 
-    int best_eval;
-    if (color) best_eval = -1000;
-    else best_eval = 1000;
+    search_split(worker, sp);
 
-    uint64_t best_move = 0;
-    for (size_t i = 0; i < moves.size(); ++i) {
-        int eval = evals[i].ret;
-        uint64_t move = moves[i];
-        if ((color && eval > best_eval) || (!color && eval < best_eval)) {
-            best_eval = eval;
-            best_move = move;
+    {
+        std::lock_guard<std::mutex> lock(split_mutex);
+        open_splits.erase(std::find(open_splits.begin(), open_splits.end(), &sp));
+    }
+    // instead of waiting idle, help the helpers
+    idle_loop(worker, &sp);
+
+    std::lock_guard<std::mutex> lock(sp.m);
+    alpha = sp.alpha;
+    beta = sp.beta;
+    best_eval = sp.best_eval;
+    best_move = sp.best_move;
+}
+
+void NegascoutParallel::search_split(Worker &worker, SplitPoint &sp) {
+    // helpers join split points of both colors, the kernel is picked by the split point
+    if (sp.cur_color) {
+        search_split<true>(worker, sp);
+    }
+    else {
+        search_split<false>(worker, sp);
+    }
+}
+
+template <bool COLOR>
+void NegascoutParallel::search_split(Worker &worker, SplitPoint &sp) {
+    SplitPoint *parent = worker.split;
+    worker.split = &sp;
+
+    while (!aborted(worker)) {
+        int i = sp.next_move.fetch_add(1, std::memory_order_relaxed);
+        if (i >= sp.move_count) {
+            break;
+        }
+        uint64_t move = sp.moves[i];
+        Board next = *sp.state;
+        next.play_move<COLOR>(move);
+
+        // load latest alpha beta values
+        int alpha;
+        int beta;
+        {
+            std::lock_guard<std::mutex> lock(sp.m);
+            alpha = sp.alpha;
+            beta = sp.beta;
+        }
+
+        int eval = -negascout<!COLOR>(worker, next, sp.depth-1, -alpha-1, -alpha, false); // minimize search window
+        if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+            eval = -negascout<!COLOR>(worker, next, sp.depth-1, -beta, -eval, false);
+        }
+
+        // result of aborted search is not valid
+        if (aborted(worker)) {
+            break;
+        }
+
+        // update shared alpha beta values, other threads stop on cutoff
+        std::lock_guard<std::mutex> lock(sp.m);
+        if (eval > sp.best_eval) {
+            sp.best_eval = eval;
+            sp.best_move = move;
+        }
+        sp.alpha = std::max(eval, sp.alpha);
+        if (sp.beta <= sp.alpha) {
+            sp.cutoff.store(true, std::memory_order_relaxed);
+            worker.history.update(*sp.state, COLOR, move, sp.depth);
         }
     }
 
-    std::cout << best_eval << '\n';
-    return best_move;
+    worker.split = parent;
 }
 
-int NegascoutParallel::negascout(Board state, int depth, bool cur_color, int alpha, int beta, bool end_board) {
+template <bool COLOR>
+int NegascoutParallel::negascout(Worker &worker, const Board &state, int depth, int alpha, int beta, bool end_board) {
     int init_alpha = alpha;
     int init_beta = beta;
     uint64_t hash = 0;
+    uint64_t hash_move = 0;
+    worker.state_count++;
+
+    // every thread reads the clock only once in a while, unfinished iteration is then thrown away
+    if (time_control && (worker.state_count & 0xfff) == 0 && std::chrono::steady_clock::now() >= deadline) {
+        stop.store(true, std::memory_order_relaxed);
+    }
+    if (aborted(worker)) {
+        return 0;
+    }
     
     // reach max depth
     if (depth == 0) {
-        return state.rate_board();
+        return relative<COLOR>(state.rate_board());
     }
     
     // check if state was already calculated
@@ -328,15 +875,15 @@ int NegascoutParallel::negascout(Board state, int depth, bool cur_color, int alp
     // too large at lower levels, it is then faster
     // to just calculate the score again
     if (settings.transposition_enable && depth > 2) {
-        hash = state.hash();
-        int score = transposition_table.get(hash, alpha, beta);
+        hash = state.hash<COLOR>();
+        int score = probe<COLOR>(transposition_table, hash, state, alpha, beta, depth, hash_move);
         if (score != TranspositionTableParallel::NOT_FOUND) {
             return score;
         }
     }
 
     // if there are no possible moves
-    uint64_t possible_moves = state.find_moves(cur_color);
+    uint64_t possible_moves = state.find_moves<COLOR>();
     int eval;
     if (possible_moves == 0) {
         if (end_board) {
@@ -345,72 +892,62 @@ int NegascoutParallel::negascout(Board state, int depth, bool cur_color, int alp
             if (count_white > count_black) {eval = 999;}
             else if (count_white < count_black) {eval = -999;}
             else {eval = 0;}
+            eval = relative<COLOR>(eval);
         }
         else {
-            eval = negascout(state, depth, !cur_color, alpha, beta, true);
+            eval = -negascout<!COLOR>(worker, state, depth, -beta, -alpha, true);
         }
         return eval;
     }
 
-    int best_eval;
-    bool first = true;
+    // move stored in transposition table is searched first, then killers and history
+    uint64_t moves[64];
+    int move_count;
+    if (depth >= HISTORY_MIN_DEPTH) {
+        move_count = worker.history.sort(move_order, state, COLOR, possible_moves, hash_move, moves);
+    }
+    else {
+        move_count = move_order.sort(possible_moves, hash_move, moves);
+    }
+
+    int best_eval = -1000;
+    uint64_t best_move = 0;
     Board next;
-    if (cur_color == true) {
-        best_eval = -1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(cur_color, move);
-                
-                if (first) { // run first move with whole window
-                    eval = negascout(next, depth-1, !cur_color, alpha, beta, false);
-                    first = false;
-                }
-                else {
-                    eval = negascout(next, depth-1, !cur_color, alpha, alpha+1, false); // minimize search window
-                    if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
-                        eval = negascout(next, depth-1, !cur_color, eval, beta, false);
-                    }
-                }
+    for (int i = 0; i < move_count; ++i) {
+        // younger brothers are shared once the eldest one is searched
+        if (i > 0 && depth >= SPLIT_MIN_DEPTH && i < move_count - 1 && idle_count.load(std::memory_order_relaxed) > 0) {
+            split(worker, state, depth, COLOR, moves + i, move_count - i, alpha, beta, best_eval, best_move);
+            break;
+        }
 
-                best_eval = std::max(eval, best_eval);
-                alpha = std::max(eval, alpha);
-                if (beta <= alpha) {
-                    break;
-                }
-            }
+        uint64_t move = moves[i];
+        next = state;
+        next.play_move<COLOR>(move);
+        
+        if (i == 0) { // run first move with whole window
+            eval = -negascout<!COLOR>(worker, next, depth-1, -beta, -alpha, false);
         }
-    }
-    else {
-        best_eval = 1000;
-        for (uint64_t move : move_order) {
-            if (possible_moves & move) {
-                next = state;
-                next.play_move(cur_color, move);
-
-                if (first) { // run first move with whole window
-                    eval = negascout(next, depth-1, !cur_color, alpha, beta, false);
-                    first = false;
-                }
-                else {
-                    eval = negascout(next, depth-1, !cur_color, beta-1, beta, false); // minimize search window
-                    if (eval < beta && eval > alpha) { // if we missed the window and there might still be better move, rerun
-                        eval = negascout(next, depth-1, !cur_color, alpha, eval, false);
-                    }
-                }
-                
-                best_eval = std::min(eval, best_eval);
-                beta = std::min(eval, beta);
-                if (beta <= alpha) {
-                    break;
-                }
+        else {
+            eval = -negascout<!COLOR>(worker, next, depth-1, -alpha-1, -alpha, false); // minimize search window
+            if (eval > alpha && eval < beta) { // if we missed the window and there might still be better move, rerun
+                eval = -negascout<!COLOR>(worker, next, depth-1, -beta, -eval, false);
             }
         }
+
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
+        }
+        alpha = std::max(eval, alpha);
+        if (beta <= alpha) {
+            worker.history.update(state, COLOR, move, depth);
+            break;
+        }
     }
     
-    // save the score for future
-    if (settings.transposition_enable && depth > 2) {
-        transposition_table.insert(hash, best_eval, init_alpha, init_beta);
+    // save the score for future, results of interrupted search are not valid
+    if (settings.transposition_enable && depth > 2 && !aborted(worker)) {
+        store<COLOR>(transposition_table, hash, state, best_eval, init_alpha, init_beta, depth, best_move);
     }
 
     return best_eval;
@@ -0,0 +1,266 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "engine/probcut.h"
+#include "engine/negascout.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+// self-play games the positions are taken from, fixed seed keeps the fit reproducible
+static constexpr int CALIBRATION_GAMES = 48;
+static constexpr unsigned int CALIBRATION_SEED = 1;
+
+// random moves at the start of every game, so the games differ
+static constexpr int OPENING_MIN = 6;
+static constexpr int OPENING_MAX = 12;
+
+// every few plies the position is searched at all depths, other moves are played quickly
+static constexpr int SAMPLE_INTERVAL = 4;
+static constexpr int PLAY_DEPTH = 4;
+
+// later positions are solved by the endgame solver anyway
+static constexpr int SAMPLE_MAX_PIECES = 56;
+
+// fits with fewer samples are too noisy, the cut stays disabled
+static constexpr int MIN_SAMPLES = 16;
+
+// fitted by ProbCut::calibrate, --calibrate -d 12
+const ProbCut::Params ProbCut::PARAMS[STAGE_COUNT][MAX_DEPTH + 1] = {
+    { // pieces 4 - 13
+        {0.000f, 0.000f, 0.000f}, // depth 0, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 1, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 2, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 3, 0 samples
+        {1.022f, -2.923f, 12.153f}, // depth 4, 29 samples
+        {0.956f, 22.019f, 14.982f}, // depth 5, 29 samples
+        {1.000f, -26.072f, 16.060f}, // depth 6, 29 samples
+        {1.057f, -4.926f, 17.488f}, // depth 7, 29 samples
+        {1.049f, 2.821f, 12.762f}, // depth 8, 29 samples
+        {1.069f, 22.467f, 13.952f}, // depth 9, 29 samples
+        {1.111f, -24.869f, 14.829f}, // depth 10, 29 samples
+        {1.132f, -7.298f, 15.906f}, // depth 11, 29 samples
+        {1.096f, 3.544f, 11.365f}, // depth 12, 29 samples
+        {0.000f, 0.000f, 0.000f}, // depth 13, 0 samples
+        {0.000f, 0.000f, 0.000f} // depth 14, 0 samples
+    },
+    { // pieces 14 - 23
+        {0.000f, 0.000f, 0.000f}, // depth 0, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 1, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 2, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 3, 0 samples
+        {1.003f, -2.589f, 18.001f}, // depth 4, 121 samples
+        {0.994f, 8.048f, 20.846f}, // depth 5, 121 samples
+        {1.010f, -16.818f, 16.712f}, // depth 6, 121 samples
+        {1.019f, -8.257f, 18.147f}, // depth 7, 121 samples
+        {1.040f, 0.451f, 10.063f}, // depth 8, 121 samples
+        {1.059f, 14.074f, 13.652f}, // depth 9, 121 samples
+        {1.065f, -9.343f, 14.647f}, // depth 10, 121 samples
+        {1.107f, 1.808f, 15.050f}, // depth 11, 121 samples
+        {1.133f, 3.374f, 12.821f}, // depth 12, 121 samples
+        {0.000f, 0.000f, 0.000f}, // depth 13, 0 samples
+        {0.000f, 0.000f, 0.000f} // depth 14, 0 samples
+    },
+    { // pieces 24 - 33
+        {0.000f, 0.000f, 0.000f}, // depth 0, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 1, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 2, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 3, 0 samples
+        {1.108f, 0.568f, 21.066f}, // depth 4, 119 samples
+        {1.113f, 5.478f, 24.523f}, // depth 5, 119 samples
+        {1.132f, -0.843f, 19.746f}, // depth 6, 119 samples
+        {1.154f, 2.257f, 21.505f}, // depth 7, 119 samples
+        {1.108f, 3.302f, 18.821f}, // depth 8, 119 samples
+        {1.128f, 10.023f, 21.094f}, // depth 9, 119 samples
+        {1.183f, -1.237f, 16.402f}, // depth 10, 119 samples
+        {1.186f, 2.926f, 19.068f}, // depth 11, 119 samples
+        {1.199f, 1.752f, 19.070f}, // depth 12, 119 samples
+        {0.000f, 0.000f, 0.000f}, // depth 13, 0 samples
+        {0.000f, 0.000f, 0.000f} // depth 14, 0 samples
+    },
+    { // pieces 34 - 43
+        {0.000f, 0.000f, 0.000f}, // depth 0, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 1, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 2, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 3, 0 samples
+        {1.097f, 1.739f, 36.467f}, // depth 4, 122 samples
+        {1.096f, 3.864f, 38.597f}, // depth 5, 122 samples
+        {1.114f, 6.843f, 34.315f}, // depth 6, 122 samples
+        {1.146f, 8.869f, 36.154f}, // depth 7, 122 samples
+        {1.067f, 4.776f, 24.765f}, // depth 8, 122 samples
+        {1.096f, 5.769f, 31.202f}, // depth 9, 121 samples
+        {1.137f, 2.949f, 33.012f}, // depth 10, 121 samples
+        {1.167f, 3.836f, 37.139f}, // depth 11, 121 samples
+        {1.205f, 4.418f, 35.693f}, // depth 12, 120 samples
+        {0.000f, 0.000f, 0.000f}, // depth 13, 0 samples
+        {0.000f, 0.000f, 0.000f} // depth 14, 0 samples
+    },
+    { // pieces 44 - 53
+        {0.000f, 0.000f, 0.000f}, // depth 0, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 1, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 2, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 3, 0 samples
+        {1.107f, 4.901f, 53.565f}, // depth 4, 120 samples
+        {1.142f, 6.722f, 62.101f}, // depth 5, 120 samples
+        {1.131f, 8.888f, 56.044f}, // depth 6, 120 samples
+        {1.143f, 11.907f, 63.891f}, // depth 7, 120 samples
+        {1.085f, 6.677f, 57.461f}, // depth 8, 120 samples
+        {1.082f, 7.866f, 67.293f}, // depth 9, 119 samples
+        {1.095f, 6.587f, 58.086f}, // depth 10, 118 samples
+        {1.092f, 4.835f, 67.530f}, // depth 11, 114 samples
+        {1.136f, 3.957f, 77.303f}, // depth 12, 104 samples
+        {0.000f, 0.000f, 0.000f}, // depth 13, 0 samples
+        {0.000f, 0.000f, 0.000f} // depth 14, 0 samples
+    },
+    { // pieces 54 - 64
+        {0.000f, 0.000f, 0.000f}, // depth 0, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 1, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 2, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 3, 0 samples
+        {1.023f, 21.833f, 66.556f}, // depth 4, 34 samples
+        {1.047f, 16.135f, 85.038f}, // depth 5, 34 samples
+        {1.047f, 19.647f, 63.700f}, // depth 6, 34 samples
+        {1.062f, 14.931f, 73.496f}, // depth 7, 32 samples
+        {1.063f, -2.572f, 53.223f}, // depth 8, 32 samples
+        {0.991f, -2.669f, 66.174f}, // depth 9, 21 samples
+        {0.000f, 0.000f, 0.000f}, // depth 10, 8 samples
+        {0.000f, 0.000f, 0.000f}, // depth 11, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 12, 0 samples
+        {0.000f, 0.000f, 0.000f}, // depth 13, 0 samples
+        {0.000f, 0.000f, 0.000f} // depth 14, 0 samples
+    }
+};
+
+int ProbCut::stage(const Board &state) {
+    int pieces = std::popcount(state.white() | state.black());
+    return std::min((pieces - 4) / 10, STAGE_COUNT - 1);
+}
+
+const ProbCut::Params *ProbCut::get(const Board &state, int depth) {
+    if (depth < MIN_DEPTH || depth > MAX_DEPTH) {
+        return nullptr;
+    }
+    const Params *params = &PARAMS[stage(state)][depth];
+    return params->sigma > 0 ? params : nullptr;
+}
+
+void ProbCut::calibrate(Engine::Settings settings) {
+    // fitted scores come from exact full width searches
+    settings.probcut_enable = false;
+    settings.lmr_rank = 0;
+    settings.endgame_empties = 0;
+    settings.time_limit = 0;
+    int max_depth = std::min(settings.search_depth, MAX_DEPTH);
+    Negascout engine(settings);
+    std::mt19937 rng(CALIBRATION_SEED);
+
+    // sums of linear regression of deep score on shallow score
+    struct Sums {
+        int n;
+        double x, y, xx, xy, yy;
+    };
+    Sums sums[STAGE_COUNT][MAX_DEPTH + 1] = {};
+
+    int position_count = 0;
+    for (int game = 0; game < CALIBRATION_GAMES; ++game) {
+        Board state = Board::States::INITIAL;
+        bool color = false;
+        bool passed = false;
+        int opening = OPENING_MIN + static_cast<int>(rng() % (OPENING_MAX - OPENING_MIN + 1));
+        for (int ply = 0; ; ++ply) {
+            uint64_t possible_moves = state.find_moves(color);
+            if (possible_moves == 0) {
+                if (passed) {
+                    break;
+                }
+                passed = true;
+                color = !color;
+                continue;
+            }
+            passed = false;
+
+            uint64_t move = 0;
+            int pieces = std::popcount(state.white() | state.black());
+            if (ply < opening) {
+                int skip = static_cast<int>(rng() % std::popcount(possible_moves));
+                for (int i = 0; i < skip; ++i) {
+                    possible_moves &= possible_moves - 1;
+                }
+                move = possible_moves & -possible_moves;
+            }
+            else if ((ply - opening) % SAMPLE_INTERVAL == 0 && pieces <= SAMPLE_MAX_PIECES) {
+                // scores of all depths, relative to the player at turn
+                int scores[MAX_DEPTH + 1];
+                for (int depth = 1; depth <= max_depth; ++depth) {
+                    scores[depth] = engine.search_fixed(state, color, depth, move);
+                    scores[depth] = color ? scores[depth] : -scores[depth];
+                }
+                for (int depth = MIN_DEPTH; depth <= max_depth; ++depth) {
+                    double x = scores[shallow_depth(depth)];
+                    double y = scores[depth];
+                    // finished games say nothing about the heuristic
+                    if (std::abs(x) >= 999 || std::abs(y) >= 999) {
+                        continue;
+                    }
+                    Sums &s = sums[stage(state)][depth];
+                    s.n++;
+                    s.x += x;
+                    s.y += y;
+                    s.xx += x * x;
+                    s.xy += x * y;
+                    s.yy += y * y;
+                }
+                position_count++;
+            }
+            else {
+                engine.search_fixed(state, color, PLAY_DEPTH, move);
+            }
+            state.play_move(color, move);
+            color = !color;
+        }
+        std::cout << "// game " << game + 1 << "/" << CALIBRATION_GAMES << ", " << position_count << " positions" << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "const ProbCut::Params ProbCut::PARAMS[STAGE_COUNT][MAX_DEPTH + 1] = {\n";
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        std::cout << "    { // pieces " << stage * 10 + 4 << " - " << (stage == STAGE_COUNT - 1 ? 64 : stage * 10 + 13) << '\n';
+        for (int depth = 0; depth <= MAX_DEPTH; ++depth) {
+            const Sums &s = sums[stage][depth];
+            double a = 0, b = 0, sigma = 0;
+            double var_x = s.n * s.xx - s.x * s.x;
+            if (s.n >= MIN_SAMPLES && var_x > 0) {
+                a = (s.n * s.xy - s.x * s.y) / var_x;
+                b = (s.y - a * s.x) / s.n;
+                // residual sum of squares expanded over the collected sums
+                double rss = s.yy - 2 * a * s.xy - 2 * b * s.y + a * a * s.xx + 2 * a * b * s.x + s.n * b * b;
+                sigma = std::sqrt(std::max(rss, 0.0) / (s.n - 2));
+            }
+            // negative slope means the shallow search predicts nothing
+            if (a <= 0) {
+                a = b = sigma = 0;
+            }
+            std::cout << "        {" << a << "f, " << b << "f, " << sigma << "f}" << (depth < MAX_DEPTH ? "," : "")
+                      << " // depth " << depth << ", " << s.n << " samples\n";
+        }
+        std::cout << "    }" << (stage < STAGE_COUNT - 1 ? "," : "") << '\n';
+    }
+    std::cout << "};\n";
+}
@@ -0,0 +1,38 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "engine/pv_table.h"
+#include <bit>
+
+PV_table::PV_table() : length(), previous_length(0), follow(0) {}
+
+std::vector<uint64_t> PV_table::line() const {
+    return std::vector<uint64_t>(moves[0], moves[0] + length[0]);
+}
+
+std::string PV_table::to_string(const std::vector<uint64_t> &line) {
+    std::string str;
+    for (uint64_t move : line) {
+        // terminal reads moves as column and row, most significant bit is the top left corner
+        int index = 63 - std::countr_zero(move);
+        if (!str.empty()) {
+            str += ' ';
+        }
+        str += std::to_string(index % 8) + ',' + std::to_string(index / 8);
+    }
+    return str;
+}
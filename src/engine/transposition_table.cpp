@@ -24,87 +24,519 @@
     #define ALWAYS_INLINE
 #endif
 
+// Compiller specific prefetch instruction
+#if defined(__GNUC__) || defined(__clang__)
+    #define PREFETCH(addr) __builtin_prefetch(addr)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <xmmintrin.h>
+    #define PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#else
+    #define PREFETCH(addr)
+#endif
+
 #include "engine/transposition_table.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#ifdef TT_STATS
+    #include <iostream>
+#endif
+
+// Statistics counters, compiled out unless TT_STATS is defined
+#ifdef TT_STATS
+    #define COUNT(counter) (++stats.counter)
+    #define COUNT_ATOMIC(counter) (stats.counter.fetch_add(1, std::memory_order_relaxed))
+#else
+    #define COUNT(counter)
+    #define COUNT_ATOMIC(counter)
+#endif
+
+// memory is zeroed on allocation, which is valid empty table
+TranspositionTable::TranspositionTable(int size_mb, const char *snapshot_file) :
+    bucket_count(count_buckets(size_mb)),
+    memory(memory_size(bucket_count, snapshot_file), snapshot_file),
+    snapshot(snapshot_file ? static_cast<SnapshotHeader*>(memory.data()) : nullptr),
+    buckets(reinterpret_cast<Bucket*>(static_cast<char*>(memory.data()) + (snapshot ? SNAPSHOT_HEADER_SIZE : 0))),
+    bucket_mask(bucket_count - 1),
+    generation(0)
+{
+    // only restored file can hold entries which have to be removed
+    if (snapshot && !open_snapshot(memory, bucket_count, false, generation) && memory.restored()) {
+        clear();
+    }
+#ifdef TT_STATS
+    stats = {};
+#endif
+#ifdef TT_VERIFY
+    boards.resize(bucket_count * bucket_size);
+#endif
+}
+
+uint64_t TranspositionTable::count_buckets(int size_mb) {
+    // round the number of buckets down to power of two, so index can be computed with simple mask
+    uint64_t count = (static_cast<uint64_t>(size_mb) << 20) / sizeof(Bucket);
+    return std::bit_floor(std::max(count, static_cast<uint64_t>(1)));
+}
+
+uint64_t TranspositionTable::memory_size(uint64_t bucket_count, const char *snapshot_file) {
+    return bucket_count * sizeof(Bucket) + (snapshot_file ? SNAPSHOT_HEADER_SIZE : 0);
+}
+
+bool TranspositionTable::open_snapshot(HugePageBuffer &memory, uint64_t bucket_count, bool xor_keys, int &generation) {
+    static constexpr char MAGIC[8] = {'R', 'E', 'V', 'E', 'R', 'S', 'T', 'T'};
+    // any change of zobrist keys changes hash of the initial board
+    uint64_t key_scheme = Board::States::INITIAL.hash(false) ^ std::rotl(Board::States::INITIAL.hash(true), 32);
+
+    // memory is either locked file or private to this process, so the header and
+    // the keys can be rewritten in place without touching table of another process
+    SnapshotHeader *header = static_cast<SnapshotHeader*>(memory.data());
+    if (memory.restored() &&
+        std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+        header->version == SNAPSHOT_VERSION &&
+        header->key_scheme == key_scheme &&
+        header->bucket_count == bucket_count)
+    {
+        if ((header->xor_keys != 0) != xor_keys) {
+            // both tables store key and data as two consecutive words
+            uint64_t *words = reinterpret_cast<uint64_t*>(static_cast<char*>(memory.data()) + SNAPSHOT_HEADER_SIZE);
+            for (uint64_t i = 0; i < bucket_count * bucket_size * 2; i += 2) {
+                words[i] ^= words[i+1];
+            }
+            header->xor_keys = xor_keys;
+        }
+        generation = header->generation & 0x3f;
+        return true;
+    }
+
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->version = SNAPSHOT_VERSION;
+    header->xor_keys = xor_keys;
+    header->key_scheme = key_scheme;
+    header->bucket_count = bucket_count;
+    header->generation = 0;
+    return false;
+}
 
 void TranspositionTable::clear() {
-    map.clear();
+    std::memset(static_cast<void*>(buckets), 0, bucket_count * sizeof(Bucket));
+    generation = 0;
+    if (snapshot) {
+        snapshot->generation = generation;
+    }
+}
+
+void TranspositionTable::new_search() {
+    generation = (generation + 1) & 0x3f;
+    if (snapshot) {
+        snapshot->generation = generation;
+    }
+#ifdef TT_STATS
+    stats = {};
+#endif
+}
+
+#ifdef TT_VERIFY
+ALWAYS_INLINE uint64_t TranspositionTable::entry_index(const Entry *entry) const {
+    return entry - buckets[0].entries;
+}
+#endif
+
+ALWAYS_INLINE uint64_t TranspositionTable::pack(int score, int type, int depth, int generation, uint64_t move) {
+    uint64_t move_code = move ? std::countr_zero(move) + 1 : 0;
+    return static_cast<uint64_t>(static_cast<uint16_t>(score)) |
+           static_cast<uint64_t>(depth & 0xff) << 16 |
+           static_cast<uint64_t>(type & 0x3) << 24 |
+           static_cast<uint64_t>(generation & 0x3f) << 26 |
+           move_code << 32;
+}
+
+ALWAYS_INLINE int TranspositionTable::unpack_score(uint64_t data) {
+    return static_cast<int16_t>(data & 0xffff);
+}
+
+ALWAYS_INLINE int TranspositionTable::unpack_type(uint64_t data) {
+    return (data >> 24) & 0x3;
+}
+
+ALWAYS_INLINE int TranspositionTable::unpack_depth(uint64_t data) {
+    return (data >> 16) & 0xff;
+}
+
+ALWAYS_INLINE int TranspositionTable::unpack_generation(uint64_t data) {
+    return (data >> 26) & 0x3f;
+}
+
+ALWAYS_INLINE uint64_t TranspositionTable::unpack_move(uint64_t data) {
+    uint64_t move_code = (data >> 32) & 0xff;
+    return move_code ? static_cast<uint64_t>(1) << (move_code - 1) : 0;
+}
+
+ALWAYS_INLINE int TranspositionTable::keep_value(uint64_t data, int generation) {
+    // empty entries go first, entries from older searches second, shallower entries third
+    int depth = unpack_depth(data);
+    if (depth == 0) {
+        return 0;
+    }
+    return unpack_generation(data) == generation ? depth + 256 : depth;
+}
+
+ALWAYS_INLINE TranspositionTable::Entry *TranspositionTable::store_always(Bucket &bucket, uint64_t key, uint64_t data) {
+    // reuse slot of the same state, otherwise replace the least valuable entry of the tier
+    Entry *slot = &bucket.entries[1];
+    for (int i = 1; i < bucket_size; ++i) {
+        Entry &e = bucket.entries[i];
+        if (e.key == key) {
+            slot = &e;
+            break;
+        }
+        if (keep_value(e.data, generation) < keep_value(slot->data, generation)) {
+            slot = &e;
+        }
+    }
+    if (slot->key != key && unpack_depth(slot->data) != 0) {
+        COUNT(overwrites);
+    }
+    slot->key = key;
+    slot->data = data;
+    return slot;
 }
 
-ALWAYS_INLINE void TranspositionTable::insert(uint64_t hash, int score, int alpha, int beta) {
-    Entry e;
-    e.score = score;
+ALWAYS_INLINE void TranspositionTable::insert(uint64_t hash, [[maybe_unused]] const Board &state, int score, int alpha, int beta, int depth, uint64_t best_move) {
+    COUNT(stores);
+    int type;
     if (score <= alpha) {
-        e.type = 2;
+        type = 2;
     }
     else if (score >= beta) {
-        e.type = 1;
+        type = 1;
     }
     else {
-        e.type = 0;
+        type = 0;
     }
-    map[hash] = e;
+    uint64_t data = pack(score, type, depth, generation, best_move);
+
+    Bucket &bucket = buckets[hash & bucket_mask];
+    Entry &deep = bucket.entries[0];
+    [[maybe_unused]] Entry *slot = &deep;
+    int deep_depth = unpack_depth(deep.data);
+    // depth-preferred entry left by older search does not block the slot
+    if (depth >= deep_depth || unpack_generation(deep.data) != generation) {
+        // entry of different state is not lost, it is moved into the always-replace tier
+        if (deep.key != hash && deep_depth != 0) {
+            [[maybe_unused]] Entry *demoted = store_always(bucket, deep.key, deep.data);
+#ifdef TT_VERIFY
+            boards[entry_index(demoted)] = boards[entry_index(&deep)];
+#endif
+        }
+        deep.key = hash;
+        deep.data = data;
+    }
+    else {
+        slot = store_always(bucket, hash, data);
+    }
+#ifdef TT_VERIFY
+    boards[entry_index(slot)] = {state.white(), state.black()};
+#endif
 }
 
-ALWAYS_INLINE int TranspositionTable::get(uint64_t hash, int alpha, int beta) {
-    if (map.find(hash) != map.end()) {
-        Entry e = map[hash];
-        if (e.type == 0) {
-            return e.score;
+ALWAYS_INLINE int TranspositionTable::get(uint64_t hash, [[maybe_unused]] const Board &state, int alpha, int beta, int depth, uint64_t &best_move) {
+    COUNT(probes);
+    const Bucket &bucket = buckets[hash & bucket_mask];
+    bool move_found = false;
+    [[maybe_unused]] bool hit = false;
+    for (const Entry &e : bucket.entries) {
+        if (e.key != hash) {
+            continue;
+        }
+#ifdef TT_VERIFY
+        // entry of different board with the same key is not used, empty slot
+        // belongs to entry restored from snapshot file and cannot be verified
+        const StoredBoard &stored = boards[entry_index(&e)];
+        if ((stored.white | stored.black) != 0 && (stored.white != state.white() || stored.black != state.black())) {
+            COUNT(collisions);
+            continue;
         }
-        if (e.type == 1 && e.score >= beta) {
-            return beta;
+#endif
+#ifdef TT_STATS
+        if (!hit) {
+            COUNT(hits);
+            hit = true;
+        }
+#endif
+        // move of the first (deepest) matching entry is the best guess, even from shallow search
+        uint64_t move = unpack_move(e.data);
+        if (!move_found && move) {
+            best_move = move;
+            move_found = true;
+        }
+        // scores from shallower searches are not reliable enough to be reused
+        if (unpack_depth(e.data) < depth) {
+            continue;
         }
-        if (e.type == 2 && e.score <= alpha) {
-            return alpha;
+        int score = unpack_score(e.data);
+        int type = unpack_type(e.data);
+        if (type == 0) {
+            COUNT(cutoffs);
+            return score;
+        }
+        // bound is returned as stored, fail-soft searches get the tighter bound
+        if (type == 1 && score >= beta) {
+            COUNT(cutoffs);
+            return score;
+        }
+        if (type == 2 && score <= alpha) {
+            COUNT(cutoffs);
+            return score;
         }
     }
     return NOT_FOUND;
 }
 
-TranspositionTableParallel::TranspositionTableParallel() : maps(map_count), mutexes(map_count) {}
+ALWAYS_INLINE void TranspositionTable::prefetch(uint64_t hash) const {
+    PREFETCH(&buckets[hash & bucket_mask]);
+}
+
+#ifdef TT_STATS
+// shared by both tables, occupancy is counted from the data words
+static void print_table_stats(uint64_t probes, uint64_t hits, uint64_t cutoffs, uint64_t stores,
+                              uint64_t overwrites, uint64_t collisions, uint64_t used, uint64_t current, uint64_t size) {
+    auto percent = [](uint64_t part, uint64_t whole) {
+        return whole ? 100.0 * part / whole : 0.0;
+    };
+    std::cout << "Transposition table statistics:\n";
+    std::cout << "Probes       " << probes << '\n';
+    std::cout << "Hits         " << hits << " (" << percent(hits, probes) << " %)\n";
+    std::cout << "Cutoffs      " << cutoffs << " (" << percent(cutoffs, probes) << " %)\n";
+    std::cout << "Stores       " << stores << '\n';
+    std::cout << "Overwrites   " << overwrites << '\n';
+#ifdef TT_VERIFY
+    std::cout << "Collisions   " << collisions << '\n';
+#else
+    static_cast<void>(collisions);
+    std::cout << "Collisions   not verified (build with TT_VERIFY)\n";
+#endif
+    std::cout << "Occupancy    " << percent(used, size) << " % (" << percent(current, size) << " % from the last search)\n";
+}
+
+void TranspositionTable::print_stats() const {
+    uint64_t used = 0;
+    uint64_t current = 0;
+    for (uint64_t i = 0; i < bucket_count; ++i) {
+        for (const Entry &e : buckets[i].entries) {
+            if (unpack_depth(e.data) != 0) {
+                used++;
+                current += unpack_generation(e.data) == generation;
+            }
+        }
+    }
+    print_table_stats(stats.probes, stats.hits, stats.cutoffs, stats.stores, stats.overwrites, stats.collisions,
+                      used, current, bucket_count * bucket_size);
+}
+#endif
+
+TranspositionTableParallel::TranspositionTableParallel(int size_mb, const char *snapshot_file) :
+    bucket_count(TranspositionTable::count_buckets(size_mb)),
+    memory(TranspositionTable::memory_size(bucket_count, snapshot_file), snapshot_file),
+    snapshot(snapshot_file ? static_cast<TranspositionTable::SnapshotHeader*>(memory.data()) : nullptr),
+    buckets(reinterpret_cast<Bucket*>(static_cast<char*>(memory.data()) + (snapshot ? TranspositionTable::SNAPSHOT_HEADER_SIZE : 0))),
+    bucket_mask(bucket_count - 1),
+    generation(0)
+{
+    // atomics have to be constructed, they start zeroed, restored entries
+    // are used in place, since atomic words have the same layout as plain ones
+    static_assert(sizeof(Bucket) == sizeof(TranspositionTable::Bucket) && std::atomic<uint64_t>::is_always_lock_free);
+    if (!snapshot || !TranspositionTable::open_snapshot(memory, bucket_count, true, generation)) {
+        std::uninitialized_default_construct_n(buckets, bucket_count);
+    }
+#ifdef TT_VERIFY
+    boards = std::vector<StoredBoard>(bucket_count * bucket_size);
+#endif
+}
 
 void TranspositionTableParallel::clear() {
-    for (auto &m : maps) {
-        m.clear();
+    for (uint64_t i = 0; i < bucket_count; ++i) {
+        for (Entry &e : buckets[i].entries) {
+            e.key.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+    if (snapshot) {
+        snapshot->generation = generation;
+    }
+}
+
+void TranspositionTableParallel::new_search() {
+    generation = (generation + 1) & 0x3f;
+    if (snapshot) {
+        snapshot->generation = generation;
+    }
+#ifdef TT_STATS
+    for (std::atomic<uint64_t> *counter : {&stats.probes, &stats.hits, &stats.cutoffs, &stats.stores, &stats.overwrites, &stats.collisions}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+#ifdef TT_VERIFY
+ALWAYS_INLINE uint64_t TranspositionTableParallel::entry_index(const Entry *entry) const {
+    return entry - buckets[0].entries;
+}
+#endif
+
+ALWAYS_INLINE TranspositionTableParallel::Entry *TranspositionTableParallel::store_always(Bucket &bucket, uint64_t key, uint64_t data) {
+    // reuse slot of the same state, otherwise replace the least valuable entry of the tier
+    Entry *slot = &bucket.entries[1];
+    uint64_t slot_data = slot->data.load(std::memory_order_relaxed);
+    int slot_value = TranspositionTable::keep_value(slot_data, generation);
+    [[maybe_unused]] bool same_key = false;
+    for (int i = 1; i < bucket_size; ++i) {
+        Entry &e = bucket.entries[i];
+        uint64_t e_data = e.data.load(std::memory_order_relaxed);
+        if ((e.key.load(std::memory_order_relaxed) ^ e_data) == key) {
+            slot = &e;
+            same_key = true;
+            break;
+        }
+        int e_value = TranspositionTable::keep_value(e_data, generation);
+        if (e_value < slot_value) {
+            slot = &e;
+            slot_data = e_data;
+            slot_value = e_value;
+        }
+    }
+#ifdef TT_STATS
+    if (!same_key && TranspositionTable::unpack_depth(slot_data) != 0) {
+        COUNT_ATOMIC(overwrites);
     }
+#endif
+    slot->key.store(key ^ data, std::memory_order_relaxed);
+    slot->data.store(data, std::memory_order_relaxed);
+    return slot;
 }
 
-ALWAYS_INLINE void TranspositionTableParallel::insert(uint64_t hash, int score, int alpha, int beta) {
-    uint64_t id = hash % map_count;
-    Entry e;
-    e.score = score;
+ALWAYS_INLINE void TranspositionTableParallel::insert(uint64_t hash, [[maybe_unused]] const Board &state, int score, int alpha, int beta, int depth, uint64_t best_move) {
+    COUNT_ATOMIC(stores);
+    int type;
     if (score <= alpha) {
-        e.type = 2;
+        type = 2;
     }
     else if (score >= beta) {
-        e.type = 1;
+        type = 1;
     }
     else {
-        e.type = 0;
+        type = 0;
     }
-    mutexes[id].lock();
-    maps[id][hash] = e;
-    mutexes[id].unlock();
+    uint64_t data = TranspositionTable::pack(score, type, depth, generation, best_move);
+
+    // other threads may write into the same bucket at the same time, worst case
+    // is lost or torn entry, which is then rejected by the key check on probe
+    Bucket &bucket = buckets[hash & bucket_mask];
+    Entry &deep = bucket.entries[0];
+    [[maybe_unused]] Entry *slot = &deep;
+    uint64_t deep_data = deep.data.load(std::memory_order_relaxed);
+    uint64_t deep_key = deep.key.load(std::memory_order_relaxed) ^ deep_data;
+    int deep_depth = TranspositionTable::unpack_depth(deep_data);
+    // depth-preferred entry left by older search does not block the slot
+    if (depth >= deep_depth || TranspositionTable::unpack_generation(deep_data) != generation) {
+        // entry of different state is not lost, it is moved into the always-replace tier
+        if (deep_key != hash && deep_depth != 0) {
+            [[maybe_unused]] Entry *demoted = store_always(bucket, deep_key, deep_data);
+#ifdef TT_VERIFY
+            StoredBoard &from = boards[entry_index(&deep)];
+            StoredBoard &to = boards[entry_index(demoted)];
+            to.white.store(from.white.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            to.black.store(from.black.load(std::memory_order_relaxed), std::memory_order_relaxed);
+#endif
+        }
+        deep.key.store(hash ^ data, std::memory_order_relaxed);
+        deep.data.store(data, std::memory_order_relaxed);
+    }
+    else {
+        slot = store_always(bucket, hash, data);
+    }
+#ifdef TT_VERIFY
+    boards[entry_index(slot)].white.store(state.white(), std::memory_order_relaxed);
+    boards[entry_index(slot)].black.store(state.black(), std::memory_order_relaxed);
+#endif
 }
 
-ALWAYS_INLINE int TranspositionTableParallel::get(uint64_t hash, int alpha, int beta) {
-    uint64_t id = hash % map_count;
-    mutexes[id].lock();
-    if (maps[id].find(hash) != maps[id].end()) {
-        Entry e = maps[id][hash];
-        mutexes[id].unlock();
-        if (e.type == 0) {
-            return e.score;
+ALWAYS_INLINE int TranspositionTableParallel::get(uint64_t hash, [[maybe_unused]] const Board &state, int alpha, int beta, int depth, uint64_t &best_move) {
+    COUNT_ATOMIC(probes);
+    const Bucket &bucket = buckets[hash & bucket_mask];
+    bool move_found = false;
+    [[maybe_unused]] bool hit = false;
+    for (const Entry &e : bucket.entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        // torn entries fail the key check
+        if ((e.key.load(std::memory_order_relaxed) ^ data) != hash) {
+            continue;
+        }
+#ifdef TT_VERIFY
+        // entry of different board with the same key is not used, empty slot
+        // belongs to entry restored from snapshot file and cannot be verified
+        const StoredBoard &stored = boards[entry_index(&e)];
+        uint64_t stored_white = stored.white.load(std::memory_order_relaxed);
+        uint64_t stored_black = stored.black.load(std::memory_order_relaxed);
+        if ((stored_white | stored_black) != 0 && (stored_white != state.white() || stored_black != state.black())) {
+            COUNT_ATOMIC(collisions);
+            continue;
         }
-        if (e.type == 1 && e.score >= beta) {
-            return beta;
+#endif
+#ifdef TT_STATS
+        if (!hit) {
+            COUNT_ATOMIC(hits);
+            hit = true;
         }
-        if (e.type == 2 && e.score <= alpha) {
-            return alpha;
+#endif
+        // move of the first (deepest) matching entry is the best guess, even from shallow search
+        uint64_t move = TranspositionTable::unpack_move(data);
+        if (!move_found && move) {
+            best_move = move;
+            move_found = true;
+        }
+        // scores from shallower searches are not reliable enough to be reused
+        if (TranspositionTable::unpack_depth(data) < depth) {
+            continue;
+        }
+        int score = TranspositionTable::unpack_score(data);
+        int type = TranspositionTable::unpack_type(data);
+        if (type == 0) {
+            COUNT_ATOMIC(cutoffs);
+            return score;
+        }
+        // bound is returned as stored, fail-soft searches get the tighter bound
+        if (type == 1 && score >= beta) {
+            COUNT_ATOMIC(cutoffs);
+            return score;
+        }
+        if (type == 2 && score <= alpha) {
+            COUNT_ATOMIC(cutoffs);
+            return score;
         }
-    }
-    else {
-        mutexes[id].unlock();
     }
     return NOT_FOUND;
 }
+
+ALWAYS_INLINE void TranspositionTableParallel::prefetch(uint64_t hash) const {
+    PREFETCH(&buckets[hash & bucket_mask]);
+}
+
+#ifdef TT_STATS
+void TranspositionTableParallel::print_stats() const {
+    uint64_t used = 0;
+    uint64_t current = 0;
+    for (uint64_t i = 0; i < bucket_count; ++i) {
+        for (const Entry &e : buckets[i].entries) {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            if (TranspositionTable::unpack_depth(data) != 0) {
+                used++;
+                current += TranspositionTable::unpack_generation(data) == generation;
+            }
+        }
+    }
+    print_table_stats(stats.probes.load(), stats.hits.load(), stats.cutoffs.load(), stats.stores.load(),
+                      stats.overwrites.load(), stats.collisions.load(), used, current, bucket_count * bucket_size);
+}
+#endif
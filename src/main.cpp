@@ -19,6 +19,9 @@
 #include "ui/terminal.h"
 #include "engine/negascout.h"
 #include "engine/alphabeta.h"
+#include "engine/lazy_smp.h"
+#include "engine/mtdf.h"
+#include "engine/probcut.h"
 #include "utils/parser.h"
 #include "board/board.h"
 #include <signal.h>
@@ -65,6 +68,20 @@ static void run_profile() {
                   << ns_per << " ns/call  (" << ITERS << " iters)\n";
     }
 
+    // --- find_moves<COLOR> ---
+    {
+        auto t0 = clock::now();
+        for (int i = 0; i < ITERS; i += 2) {
+            sink = boards[i % 3].find_moves<false>();
+            sink = boards[(i + 1) % 3].find_moves<true>();
+        }
+        auto t1 = clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double ns_per = ms * 1e6 / ITERS;
+        std::cout << "find_moves<COLOR> : " << ms << " ms total, "
+                  << ns_per << " ns/call  (" << ITERS << " iters)\n";
+    }
+
     // --- rate_board ---
     {
         auto t0 = clock::now();
@@ -118,10 +135,22 @@ int main(int argc, char **argv) {
     Parser parser;
     if (!parser.parse(argc, argv)) return 1;
 
+    // calibration plays its own games with its own engine
+    if (parser.get_mode() == App::Mode::CALIBRATE) {
+        ProbCut::calibrate(parser.get_settings());
+        return 0;
+    }
+
     // initialize engine
     if (parser.get_alg() == Engine::Alg::ALPHABETA) {
         engine = new Alphabeta(parser.get_settings());
     }
+    else if (parser.get_alg() == Engine::Alg::LAZY_SMP) {
+        engine = new LazySMP(parser.get_settings());
+    }
+    else if (parser.get_alg() == Engine::Alg::MTDF) {
+        engine = new Mtdf(parser.get_settings());
+    }
     else if (parser.get_alg() == Engine::Alg::NEGASCOUT && parser.get_settings().thread_count > 1) {
         engine = new NegascoutParallel(parser.get_settings());
     }
@@ -0,0 +1,160 @@
+/*
+    This file is part of Reversan Engine.
+
+    Reversan Engine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Reversan Engine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Reversan Engine. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include "utils/huge_page_buffer.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+HugePageBuffer::HugePageBuffer(size_t size, const char *file_path) : ptr(nullptr), buffer_size(size), mapped_size(0), file_descriptor(-1), file_restored(false) {
+    if (file_path == nullptr) {
+        allocate(size);
+        return;
+    }
+    if (map_file(size, file_path)) {
+        return;
+    }
+#if defined(__linux__)
+    std::cerr << "Could not map file " << file_path << ", using anonymous memory instead\n";
+    allocate(size);
+#else
+    // without mmap the file is loaded now and saved at destruction
+    allocate(size);
+    write_back_path = file_path;
+    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+    if (file && static_cast<size_t>(file.tellg()) == size) {
+        file.seekg(0);
+        file_restored = static_cast<bool>(file.read(static_cast<char*>(ptr), size));
+        if (!file_restored) {
+            std::memset(ptr, 0, size);
+        }
+    }
+#endif
+}
+
+bool HugePageBuffer::map_file(size_t size, const char *path) {
+#if defined(__linux__)
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // single writer, file used by another process must not be resized or written under its mapping
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return false;
+    }
+    struct stat file_stat;
+    bool restored = fstat(fd, &file_stat) == 0 && static_cast<size_t>(file_stat.st_size) == size;
+    // file of different size is useless, start from zeroed one
+    if (!restored && (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0)) {
+        close(fd);
+        return false;
+    }
+    // restored content is wanted right away, so it is read in before the search starts
+    int flags = MAP_SHARED;
+    #if defined(MAP_POPULATE)
+    if (restored) {
+        flags |= MAP_POPULATE;
+    }
+    #endif
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    // descriptor stays open until the mapping is gone, closing it would release the lock
+    ptr = map;
+    mapped_size = size;
+    file_descriptor = fd;
+    file_restored = restored;
+    return true;
+#else
+    static_cast<void>(size);
+    static_cast<void>(path);
+    return false;
+#endif
+}
+
+void HugePageBuffer::allocate(size_t size) {
+#if defined(__linux__)
+    // huge pages are used only for whole 2 MB blocks aligned to 2 MB,
+    // so map one extra page and cut the unaligned head and tail off
+    size_t rounded_size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    size_t map_size = rounded_size + HUGE_PAGE_SIZE;
+    void *map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map != MAP_FAILED) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(map);
+        uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        if (aligned > start) {
+            munmap(map, aligned - start);
+        }
+        size_t tail = start + map_size - (aligned + rounded_size);
+        if (tail > 0) {
+            munmap(reinterpret_cast<void*>(aligned + rounded_size), tail);
+        }
+        ptr = reinterpret_cast<void*>(aligned);
+        mapped_size = rounded_size;
+    #if defined(MADV_HUGEPAGE)
+        madvise(ptr, mapped_size, MADV_HUGEPAGE);
+    #endif
+        return;
+    }
+#endif
+    // fallback, anonymous mappings are already zeroed so only this path needs memset
+    ptr = ::operator new(size, std::align_val_t(64));
+    std::memset(ptr, 0, size);
+}
+
+HugePageBuffer::~HugePageBuffer() {
+#if defined(__linux__)
+    // shared file mapping is written back by the kernel
+    if (mapped_size != 0) {
+        munmap(ptr, mapped_size);
+        if (file_descriptor >= 0) {
+            close(file_descriptor);
+        }
+        return;
+    }
+#endif
+    if (!write_back_path.empty()) {
+        std::ofstream file(write_back_path, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char*>(ptr), buffer_size);
+    }
+    ::operator delete(ptr, std::align_val_t(64));
+}
+
+void *HugePageBuffer::data() const {
+    return ptr;
+}
+
+size_t HugePageBuffer::size() const {
+    return buffer_size;
+}
+
+bool HugePageBuffer::restored() const {
+    return file_restored;
+}
@@ -39,12 +39,31 @@ void Parser::print_help() const {
         << "--play                                    Play against the engine in terminal interface.\n"
         << "--bot-vs-bot                              Start game where the engine plays against itself.\n"
         << "--benchmark                               Run search on pre-defined state.\n"
+        << "--solve                                   Solve pre-defined endgame state to the end of the game, negascout with one thread only.\n"
+        << "--calibrate                               Fit probcut parameters from self-play, depth sets the deepest fitted search.\n"
         << "\n"
         << "Additional Options:\n"
         << "--depth, -d <1 - 49> [10]                           Set the engine's search depth.\n"
-        << "--engine, -e <negascout | alphabeta> [negascout]    Choose the tree search algorithm.\n"
-        << "--threads, -t, <1 - 8> [1]                          EXPERIMENTAL, negascout only.\n"
+        << "--time-limit <0 - 3600000> [0]                      Set time limit per move in milliseconds, 0 for no limit, not for alphabeta.\n"
+        << "--aspiration <0 - 1000> [16]                        Set initial aspiration window half-width, 0 for full window.\n"
+        << "--aspiration-growth <2 - 16> [2]                    Set factor widening the aspiration window after failed search.\n"
+        << "--endgame <0 - 60> [20]                             Solve exactly from this number of empty squares, 0 to disable, negascout only.\n"
+        << "--wld                                               Endgame solver only decides win, loss or draw, negascout with one thread only.\n"
+        << "--engine, -e <negascout | alphabeta | lazysmp | mtdf> [negascout]\n"
+        << "                                                    Choose the tree search algorithm.\n"
+        << "--threads, -t, <1 - 256> [1]                        Number of search threads, negascout and lazysmp only.\n"
         << "--disable-tp                                        Disables transposition tables.\n"
+        << "--hash-mb <1 - 65536> [64]                          Set transposition table size in megabytes.\n"
+        << "--hash-file <path>                                  Keep transposition table in file between runs.\n"
+        << "--disable-prefetch                                  Disables transposition table prefetching, negascout only.\n"
+        << "--disable-etc                                       Disables enhanced transposition cutoffs, negascout only.\n"
+        << "--disable-iid                                       Disables internal iterative deepening, negascout only.\n"
+        << "--disable-ponder                                    Disables searching during the player's turn, negascout only.\n"
+        << "--probcut                                           Enables multi-probcut selective search, negascout only.\n"
+        << "--lmr <0 - 60> [0]                                  Search moves from this rank on shallower first, 0 to disable, negascout only.\n"
+        << "--lmr-min-depth <3 - 60> [3]                        Nodes shallower than this never reduce moves, negascout only.\n"
+        << "--lmr-divisor <0.5 - 16> [2]                        Larger divisor reduces fewer moves by more than one ply, negascout only.\n"
+        << "--lmr-max-reduction <1 - 16> [2]                    Deepest reduction in plies, negascout only.\n"
         << "--order, -o <line_by_line | opt1 | opt2> [opt1]     Sets search order of the engine.\n"
         << "--style, -s <basic | solarized | dracula> [basic]   Specify UI style.\n";
 }
@@ -59,6 +78,8 @@ bool Parser::parse_mode(int argc, char **argv) {
     if (arg == "--play") mode = App::Mode::PLAY;
     else if (arg == "--bot-vs-bot") mode = App::Mode::BOT_VS_BOT;
     else if (arg == "--benchmark") mode = App::Mode::BENCHMARK;
+    else if (arg == "--solve") mode = App::Mode::SOLVE;
+    else if (arg == "--calibrate") mode = App::Mode::CALIBRATE;
     else return false;
     // return true if mode was parsed
     return true;
@@ -86,6 +107,8 @@ bool Parser::parse_engine(int argc, char **argv, int &i) {
         std::string arg = argv[i];
         if (arg == "alphabeta") alg = Engine::Alg::ALPHABETA;
         else if (arg == "negascout") alg = Engine::Alg::NEGASCOUT;
+        else if (arg == "lazysmp") alg = Engine::Alg::LAZY_SMP;
+        else if (arg == "mtdf") alg = Engine::Alg::MTDF;
         else {
             std::cout << "Invalid search engine. Use --help or -h for usage information.\n";
             return false;
@@ -121,7 +144,7 @@ bool Parser::parse_threads(int argc, char **argv, int &i) {
     if (i + 1 < argc) {
         i++;
         settings.thread_count = std::atoi(argv[i]);
-        if (settings.thread_count < 1 || settings.thread_count > 128) {
+        if (settings.thread_count < 1 || settings.thread_count > 256) {
             std::cout << "Invalid thread count. Use --help or -h for usage information.\n";
             return false;
         }
@@ -152,6 +175,133 @@ bool Parser::parse_order(int argc, char **argv, int &i) {
     return true;
 }
 
+bool Parser::parse_hash_size(int argc, char **argv, int &i) {
+    if (i + 1 < argc) {
+        i++;
+        settings.hash_size = std::atoi(argv[i]);
+        if (settings.hash_size < 1 || settings.hash_size > 65536) {
+            std::cout << "Invalid transposition table size. Use --help or -h for usage information.\n";
+            return false;
+        }
+    }
+    else {
+        std::cout << "Flag --hash-mb requires an additional argument. Use --help or -h for usage information.\n";
+        return false;
+    }
+    return true;
+}
+
+bool Parser::parse_time_limit(int argc, char **argv, int &i) {
+    if (i + 1 < argc) {
+        i++;
+        settings.time_limit = std::atoi(argv[i]);
+        if (settings.time_limit < 0 || settings.time_limit > 3600000) {
+            std::cout << "Invalid time limit. Use --help or -h for usage information.\n";
+            return false;
+        }
+    }
+    else {
+        std::cout << "Flag --time-limit requires an additional argument. Use --help or -h for usage information.\n";
+        return false;
+    }
+    return true;
+}
+
+bool Parser::parse_aspiration(int argc, char **argv, int &i) {
+    std::string arg = argv[i];
+    if (i + 1 < argc) {
+        i++;
+        if (arg == "--aspiration") {
+            settings.aspiration_window = std::atoi(argv[i]);
+            if (settings.aspiration_window < 0 || settings.aspiration_window > 1000) {
+                std::cout << "Invalid aspiration window. Use --help or -h for usage information.\n";
+                return false;
+            }
+        }
+        else {
+            settings.aspiration_growth = std::atoi(argv[i]);
+            if (settings.aspiration_growth < 2 || settings.aspiration_growth > 16) {
+                std::cout << "Invalid aspiration growth. Use --help or -h for usage information.\n";
+                return false;
+            }
+        }
+    }
+    else {
+        std::cout << "Flag " << arg << " requires an additional argument. Use --help or -h for usage information.\n";
+        return false;
+    }
+    return true;
+}
+
+bool Parser::parse_endgame(int argc, char **argv, int &i) {
+    if (i + 1 < argc) {
+        i++;
+        settings.endgame_empties = std::atoi(argv[i]);
+        if (settings.endgame_empties < 0 || settings.endgame_empties > 60) {
+            std::cout << "Invalid endgame empties. Use --help or -h for usage information.\n";
+            return false;
+        }
+    }
+    else {
+        std::cout << "Flag --endgame requires an additional argument. Use --help or -h for usage information.\n";
+        return false;
+    }
+    return true;
+}
+
+bool Parser::parse_lmr(int argc, char **argv, int &i) {
+    std::string arg = argv[i];
+    if (i + 1 < argc) {
+        i++;
+        if (arg == "--lmr") {
+            settings.lmr_rank = std::atoi(argv[i]);
+            if (settings.lmr_rank < 0 || settings.lmr_rank > 60) {
+                std::cout << "Invalid reduced move rank. Use --help or -h for usage information.\n";
+                return false;
+            }
+        }
+        else if (arg == "--lmr-min-depth") {
+            // reduced search has to stay at least one ply deep
+            settings.lmr_min_depth = std::atoi(argv[i]);
+            if (settings.lmr_min_depth < 3 || settings.lmr_min_depth > 60) {
+                std::cout << "Invalid reduction depth. Use --help or -h for usage information.\n";
+                return false;
+            }
+        }
+        else if (arg == "--lmr-divisor") {
+            settings.lmr_divisor = std::atof(argv[i]);
+            if (settings.lmr_divisor < 0.5 || settings.lmr_divisor > 16) {
+                std::cout << "Invalid reduction divisor. Use --help or -h for usage information.\n";
+                return false;
+            }
+        }
+        else {
+            settings.lmr_max_reduction = std::atoi(argv[i]);
+            if (settings.lmr_max_reduction < 1 || settings.lmr_max_reduction > 16) {
+                std::cout << "Invalid maximum reduction. Use --help or -h for usage information.\n";
+                return false;
+            }
+        }
+    }
+    else {
+        std::cout << "Flag " << arg << " requires an additional argument. Use --help or -h for usage information.\n";
+        return false;
+    }
+    return true;
+}
+
+bool Parser::parse_hash_file(int argc, char **argv, int &i) {
+    if (i + 1 < argc) {
+        i++;
+        settings.hash_file = argv[i];
+    }
+    else {
+        std::cout << "Flag --hash-file requires an additional argument. Use --help or -h for usage information.\n";
+        return false;
+    }
+    return true;
+}
+
 bool Parser::parse(int argc, char **argv) {
     int idx = 1;
     // parse mode
@@ -164,6 +314,18 @@ bool Parser::parse(int argc, char **argv) {
         if (arg == "--depth" || arg == "-d") {
             if (!parse_depth(argc, argv, i)) return false;
         }
+        else if (arg == "--time-limit") {
+            if (!parse_time_limit(argc, argv, i)) return false;
+        }
+        else if (arg == "--aspiration" || arg == "--aspiration-growth") {
+            if (!parse_aspiration(argc, argv, i)) return false;
+        }
+        else if (arg == "--endgame") {
+            if (!parse_endgame(argc, argv, i)) return false;
+        }
+        else if (arg == "--lmr" || arg == "--lmr-min-depth" || arg == "--lmr-divisor" || arg == "--lmr-max-reduction") {
+            if (!parse_lmr(argc, argv, i)) return false;
+        }
         else if (arg == "--engine" || arg == "-e") {
             if (!parse_engine(argc, argv, i)) return false;
         }
@@ -180,6 +342,30 @@ bool Parser::parse(int argc, char **argv) {
         else if (arg == "--disable-tp") {
             settings.transposition_enable = false;
         }
+        else if (arg == "--wld") {
+            settings.endgame_wld = true;
+        }
+        else if (arg == "--disable-prefetch") {
+            settings.prefetch_enable = false;
+        }
+        else if (arg == "--disable-etc") {
+            settings.etc_enable = false;
+        }
+        else if (arg == "--disable-iid") {
+            settings.iid_enable = false;
+        }
+        else if (arg == "--disable-ponder") {
+            settings.ponder_enable = false;
+        }
+        else if (arg == "--probcut") {
+            settings.probcut_enable = true;
+        }
+        else if (arg == "--hash-mb") {
+            if (!parse_hash_size(argc, argv, i)) return false;
+        }
+        else if (arg == "--hash-file") {
+            if (!parse_hash_file(argc, argv, i)) return false;
+        }
         else if (arg == "--order" || arg == "-o") {
             if (!parse_order(argc, argv, i)) return false;
         }
@@ -188,6 +374,21 @@ bool Parser::parse(int argc, char **argv) {
             return false;
         }
     }
+    // only single-threaded negascout has the endgame solver, other engines would
+    // report a heuristic score instead of the solved one
+    bool solver_engine = alg == Engine::Alg::NEGASCOUT && settings.thread_count == 1;
+    if (mode == App::Mode::SOLVE && !solver_engine) {
+        std::cout << "Mode --solve requires negascout engine with one thread. Use --help or -h for usage information.\n";
+        return false;
+    }
+    if (settings.endgame_wld && !solver_engine) {
+        std::cout << "Flag --wld requires negascout engine with one thread. Use --help or -h for usage information.\n";
+        return false;
+    }
+    // solve mode always searches to the end of the game
+    if (mode == App::Mode::SOLVE) {
+        settings.endgame_empties = 60;
+    }
     // if we got here, everything was correctly parsed
     return true;
 }